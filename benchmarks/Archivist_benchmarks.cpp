@@ -0,0 +1,134 @@
+#include "Benchmark.hpp"
+
+#include <sztronics/miscellaneous/Archivist.hpp>
+
+#include <random>
+#include <algorithm>
+#include <cstdio>
+
+/// @return Locator of the index-th populated entry.
+static std::string entry_locator(const char* prefix, size_t index)
+{
+    char locator[32];
+    std::snprintf(locator, sizeof(locator), "%s/%08zu", prefix, index);
+    return locator;
+}
+
+/// @brief Writes n_entries "key/<index>" entries holding their index as uint64,
+///        straight in Archivist's file format, so large stores don't take minutes to build.
+static void populate(const std::string& filename, size_t n_entries)
+{
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    int n = static_cast<int>(n_entries);
+    out.write((char*)&n, sizeof(n));
+
+    for (size_t i = 0; i < n_entries; i++) {
+        std::string locator = entry_locator("key", i);
+        unsigned short locator_size = locator.size();
+        uint64_t value = i;
+        unsigned int data_size = sizeof(value);
+
+        out.write((char*)&locator_size, sizeof(locator_size));
+        out.write((char*)&data_size, sizeof(data_size));
+        out.write(locator.data(), locator_size);
+        out.write((char*)&value, sizeof(value));
+    }
+}
+
+BENCHMARK(archivist)
+{
+    std::string filename = (std::filesystem::temp_directory_path() / "sztronics_benchmark.arc").string();
+    std::vector<size_t> sizes = {1000, 10000, 100000, 1000000};
+    if (context.quick()) {
+        sizes = {1000, 10000};
+    }
+
+    for (size_t n_entries : sizes) {
+        // Every operation scans the file, so the number of operations shrinks as it grows
+        size_t n_ops = std::max<size_t>(2, std::min<size_t>(1000, 2000000 / n_entries));
+        Benchmark_context::Values params = {{"entries", static_cast<double>(n_entries)}};
+        std::mt19937_64 rng(n_entries);
+        auto random_key = [&]() { return entry_locator("key", rng() % n_entries); };
+
+        populate(filename, n_entries);
+        {
+            Archivist archivist(filename);
+            uint64_t sum = 0;
+
+            context.measure("archivist/get", params, n_ops, [&]() {
+                for (size_t i = 0; i < n_ops; i++) {
+                    sum += archivist.get<uint64_t>(random_key()).value_or(0);
+                }
+            });
+            context.measure("archivist/get_missing", params, n_ops, [&]() {
+                for (size_t i = 0; i < n_ops; i++) {
+                    sum += archivist.get<uint64_t>("missing").value_or(0);
+                }
+            });
+            // Same reads resolved in one pass per batch
+            std::vector<std::string> locators(n_ops);
+            context.measure("archivist/get_many", params, n_ops, [&]() {
+                for (std::string& locator : locators) {
+                    locator = random_key();
+                }
+                for (std::optional<uint64_t>& value : archivist.get_many<uint64_t>(locators)) {
+                    sum += value.value_or(0);
+                }
+            });
+            context.measure("archivist/get_async", params, n_ops, [&]() {
+                std::vector<std::future<std::optional<uint64_t>>> values;
+                for (size_t i = 0; i < n_ops; i++) {
+                    values.push_back(archivist.get_async<uint64_t>(random_key()));
+                }
+                for (std::future<std::optional<uint64_t>>& value : values) {
+                    sum += value.get().value_or(0);
+                }
+            });
+            do_not_optimize(sum);
+
+            context.measure("archivist/put_overwrite", params, n_ops, [&]() {
+                for (size_t i = 0; i < n_ops; i++) {
+                    archivist.put<uint64_t>(random_key(), i);
+                }
+            });
+
+            // Overwrites while a snapshot is held also copy the old value into it on first touch
+            {
+                Archivist::Snapshot snapshot = archivist.snapshot();
+                context.measure_once("archivist/put_overwrite_snapshot", params, n_ops, [&]() {
+                    for (size_t i = 0; i < n_ops; i++) {
+                        archivist.put<uint64_t>(random_key(), i);
+                    }
+                });
+                size_t n_visited = 0;
+                context.measure_once("archivist/snapshot_for_each", params, n_entries, [&]() {
+                    snapshot.for_each([&](const std::string&, const Serialized&) { n_visited++; });
+                });
+                do_not_optimize(n_visited);
+            }
+
+            size_t n_new = 0;
+            context.measure_once("archivist/put_new", params, n_ops, [&]() {
+                for (size_t i = 0; i < n_ops; i++) {
+                    archivist.put<uint64_t>(entry_locator("new", n_new++), i);
+                }
+            });
+
+            // Distinct keys, deleted in random order
+            std::vector<size_t> order(n_entries);
+            for (size_t i = 0; i < n_entries; i++) {
+                order[i] = i;
+            }
+            std::shuffle(order.begin(), order.end(), rng);
+            size_t n_deleted = 0;
+            size_t n_del_ops = std::min(n_ops, n_entries / 16);
+            context.measure_once("archivist/del", params, n_del_ops, [&]() {
+                for (size_t i = 0; i < n_del_ops && n_deleted < n_entries; i++) {
+                    archivist.del(entry_locator("key", order[n_deleted++]));
+                }
+            });
+        }
+        std::filesystem::remove(filename);
+        std::filesystem::remove(filename + ARCHIVIST_FILTER_SUFFIX);
+    }
+}
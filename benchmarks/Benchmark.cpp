@@ -0,0 +1,250 @@
+#include "Benchmark.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <ctime>
+#include <thread>
+
+#ifndef SZTRONICS_VERSION
+#define SZTRONICS_VERSION "unknown"
+#endif
+#ifndef SZTRONICS_BUILD_TYPE
+#define SZTRONICS_BUILD_TYPE "unknown"
+#endif
+
+struct Benchmark_group
+{
+    const char* name;
+    Benchmark_function function;
+};
+
+/// @brief Registered groups; a function-local static so registration order doesn't matter.
+static std::vector<Benchmark_group>& registry()
+{
+    static std::vector<Benchmark_group> groups;
+    return groups;
+}
+
+Benchmark_registration::Benchmark_registration(const char* group, Benchmark_function function)
+{
+    registry().push_back({group, function});
+}
+
+void Benchmark_context::measure(const std::string& name, const Values& params, uint64_t n_ops,
+                                const std::function<void(void)>& body)
+{
+    body();
+    measure_once(name, params, n_ops, body);
+}
+
+void Benchmark_context::measure_once(const std::string& name, const Values& params, uint64_t n_ops,
+                                     const std::function<void(void)>& body)
+{
+    std::vector<uint64_t> run_ns;
+    for (unsigned i = 0; i < options.repetitions; i++) {
+        uint64_t start = benchmark_now();
+        body();
+        run_ns.push_back(benchmark_now() - start);
+    }
+    report_runs(name, params, n_ops, std::move(run_ns));
+}
+
+void Benchmark_context::report_runs(const std::string& name, const Values& params, uint64_t n_ops,
+                                    std::vector<uint64_t> run_ns)
+{
+    std::sort(run_ns.begin(), run_ns.end());
+    double ops = static_cast<double>(std::max<uint64_t>(n_ops, 1));
+    double total = 0;
+    for (uint64_t ns : run_ns) {
+        total += ns;
+    }
+    double median = run_ns[run_ns.size() / 2] / ops;
+
+    report(name, params, {{"ns_per_op_min", run_ns.front() / ops},
+                          {"ns_per_op_median", median},
+                          {"ns_per_op_mean", total / run_ns.size() / ops},
+                          {"ops_per_second", median > 0 ? 1e9 / median : 0},
+                          {"ops_per_run", ops},
+                          {"runs", static_cast<double>(run_ns.size())}});
+}
+
+void Benchmark_context::report_latencies(const std::string& name, const Values& params, std::vector<uint64_t> latencies_ns)
+{
+    if (latencies_ns.empty()) {
+        return;
+    }
+    std::sort(latencies_ns.begin(), latencies_ns.end());
+    auto percentile = [&](double p) {
+        return static_cast<double>(latencies_ns[std::min(latencies_ns.size() - 1,
+                                                         static_cast<size_t>(p * latencies_ns.size()))]);
+    };
+    double total = 0;
+    for (uint64_t ns : latencies_ns) {
+        total += ns;
+    }
+    report(name, params, {{"p50_ns", percentile(0.5)},
+                          {"p90_ns", percentile(0.9)},
+                          {"p99_ns", percentile(0.99)},
+                          {"p999_ns", percentile(0.999)},
+                          {"max_ns", static_cast<double>(latencies_ns.back())},
+                          {"mean_ns", total / latencies_ns.size()},
+                          {"samples", static_cast<double>(latencies_ns.size())}});
+}
+
+void Benchmark_context::report(const std::string& name, const Values& params, const Values& metrics)
+{
+    results.push_back({name, params, metrics});
+
+    // Progress for humans goes to stderr, so stdout stays valid JSON
+    std::cerr << name;
+    for (const std::pair<std::string, double>& param : params) {
+        std::cerr << ' ' << param.first << '=' << param.second;
+    }
+    for (const std::pair<std::string, double>& metric : metrics) {
+        std::cerr << (&metric == &metrics.front() ? ": " : ", ") << metric.first << ' ' << metric.second;
+    }
+    std::cerr << '\n';
+}
+
+/// @brief Writes str as a JSON string literal.
+static void write_json_string(std::ostream& out, const std::string& str)
+{
+    out << '"';
+    for (char ch : str) {
+        if (ch == '"' || ch == '\\') {
+            out << '\\' << ch;
+        }
+        else if (static_cast<unsigned char>(ch) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", ch);
+            out << escaped;
+        }
+        else {
+            out << ch;
+        }
+    }
+    out << '"';
+}
+
+/// @brief Writes values as a JSON object. NaN and infinities become null.
+static void write_json_values(std::ostream& out, const Benchmark_context::Values& values)
+{
+    out << '{';
+    for (size_t i = 0; i < values.size(); i++) {
+        out << (i == 0 ? "" : ", ");
+        write_json_string(out, values[i].first);
+        out << ": ";
+        if (std::isfinite(values[i].second)) {
+            out << values[i].second;
+        }
+        else {
+            out << "null";
+        }
+    }
+    out << '}';
+}
+
+void Benchmark_context::write_json(std::ostream& out) const
+{
+    char timestamp[32];
+    std::time_t now = std::time(nullptr);
+    std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+    out.precision(6);
+    out << "{\n  \"schema\": 1,\n  \"library\": \"sztronics_miscellaneous\",\n  \"version\": ";
+    write_json_string(out, SZTRONICS_VERSION);
+    out << ",\n  \"build_type\": ";
+    write_json_string(out, SZTRONICS_BUILD_TYPE);
+    out << ",\n  \"compiler\": ";
+    write_json_string(out, __VERSION__);
+    out << ",\n  \"timestamp\": ";
+    write_json_string(out, timestamp);
+    out << ",\n  \"hardware_threads\": " << std::thread::hardware_concurrency()
+        << ",\n  \"quick\": " << (options.quick ? "true" : "false")
+        << ",\n  \"results\": [";
+
+    for (size_t i = 0; i < results.size(); i++) {
+        out << (i == 0 ? "\n" : ",\n") << "    {\"name\": ";
+        write_json_string(out, results[i].name);
+        out << ", \"params\": ";
+        write_json_values(out, results[i].params);
+        out << ", \"metrics\": ";
+        write_json_values(out, results[i].metrics);
+        out << '}';
+    }
+    out << "\n  ]\n}\n";
+}
+
+static void print_usage(const char* program)
+{
+    std::cerr << "Usage: " << program << " [options]\n"
+              << "  --filter <text>      Run only groups whose name contains text (repeatable)\n"
+              << "  --out <file>         Write JSON results to file instead of stdout\n"
+              << "  --repetitions <n>    Timed runs per measurement (default 5)\n"
+              << "  --quick              Skip the largest problem sizes\n"
+              << "  --list               Print the group names and exit\n";
+}
+
+int main(int argc, char** argv)
+{
+    Benchmark_context::Options options;
+    std::vector<std::string> filters;
+    std::string out_filename;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if (arg == "--filter" && has_value) {
+            filters.push_back(argv[++i]);
+        }
+        else if (arg == "--out" && has_value) {
+            out_filename = argv[++i];
+        }
+        else if (arg == "--repetitions" && has_value) {
+            options.repetitions = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--quick") {
+            options.quick = true;
+        }
+        else if (arg == "--list") {
+            for (const Benchmark_group& group : registry()) {
+                std::cout << group.name << '\n';
+            }
+            return 0;
+        }
+        else {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+
+    std::vector<Benchmark_group> groups = registry();
+    std::sort(groups.begin(), groups.end(), [](const Benchmark_group& a, const Benchmark_group& b) {
+        return std::strcmp(a.name, b.name) < 0;
+    });
+
+    Benchmark_context context(options);
+    for (const Benchmark_group& group : groups) {
+        bool selected = filters.empty();
+        for (const std::string& filter : filters) {
+            selected = selected || std::string(group.name).find(filter) != std::string::npos;
+        }
+        if (selected) {
+            group.function(context);
+        }
+    }
+
+    if (out_filename.empty()) {
+        context.write_json(std::cout);
+        return std::cout.good() ? 0 : 1;
+    }
+    std::ofstream out(out_filename);
+    context.write_json(out);
+    return out.good() ? 0 : 1;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <utility>
+#include <functional>
+#include <stdint.h>
+
+#define BENCHMARK_CONCAT_(a, b) a##b
+#define BENCHMARK_CONCAT(a, b) BENCHMARK_CONCAT_(a, b)
+
+/// @brief Defines and registers a benchmark group:
+///        BENCHMARK(archivist) { context.measure(...); }
+///        The group name is what --filter matches against.
+#define BENCHMARK(group) \
+    static void BENCHMARK_CONCAT(benchmark_, group)(Benchmark_context& context); \
+    static Benchmark_registration BENCHMARK_CONCAT(benchmark_registration_, group)( \
+        #group, BENCHMARK_CONCAT(benchmark_, group)); \
+    static void BENCHMARK_CONCAT(benchmark_, group)(Benchmark_context& context)
+
+/// @brief Keeps the compiler from optimizing away the computation of value.
+template <typename Type>
+inline void do_not_optimize(Type& value)
+{
+    asm volatile("" : "+m"(value) : : "memory");
+}
+
+/// @return Steady clock time in nanoseconds.
+inline uint64_t benchmark_now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/// @brief Collects the results of one harness run and writes them out as JSON.
+class Benchmark_context
+{
+    public:
+    /// @brief Numeric key-value pairs; names are JSON keys.
+    using Values = std::vector<std::pair<std::string, double>>;
+
+    struct Result
+    {
+        std::string name;
+        Values params;
+        Values metrics;
+    };
+
+    struct Options
+    {
+        bool quick = false;        /// Skip the largest problem sizes.
+        unsigned repetitions = 5;  /// Timed runs per measure() call, after one warm-up run.
+    };
+
+    explicit Benchmark_context(Options options) : options(options) {}
+
+    inline bool quick() const { return options.quick; }
+    inline const std::vector<Result>& get_results() const { return results; }
+
+    /// @brief Times body over the configured repetitions, after one untimed warm-up run.
+    ///        Reports min, median and mean time per operation, and operations per second of the median.
+    /// @param n_ops Number of operations one call of body performs.
+    void measure(const std::string& name, const Values& params, uint64_t n_ops, const std::function<void(void)>& body);
+
+    /// @brief Like measure(), without the warm-up run, for bodies that change the state they measure.
+    void measure_once(const std::string& name, const Values& params, uint64_t n_ops, const std::function<void(void)>& body);
+
+    /// @brief Reports the distribution of individual operation latencies (p50, p90, p99, p99.9, max, mean).
+    void report_latencies(const std::string& name, const Values& params, std::vector<uint64_t> latencies_ns);
+
+    /// @brief Reports arbitrary metrics.
+    void report(const std::string& name, const Values& params, const Values& metrics);
+
+    /// @brief Writes every result, with build and host details, as one JSON document.
+    void write_json(std::ostream& out) const;
+
+    private:
+    Options options;
+    std::vector<Result> results;
+
+    void report_runs(const std::string& name, const Values& params, uint64_t n_ops, std::vector<uint64_t> run_ns);
+};
+
+using Benchmark_function = void(*)(Benchmark_context& context);
+
+/// @brief Adds a benchmark group to the harness; created by BENCHMARK().
+struct Benchmark_registration
+{
+    Benchmark_registration(const char* group, Benchmark_function function);
+};
@@ -0,0 +1,60 @@
+// Built as C++20 (see CMakeLists.txt), which also keeps Timer_coroutines.hpp compiling.
+#include "Benchmark.hpp"
+
+#include <sztronics/miscellaneous/Timer_coroutines.hpp>
+
+#include <thread>
+
+using namespace std::chrono_literals;
+
+static Timer_task wait_once(Timer& timer, uint64_t& n_resumed)
+{
+    co_await after(timer, 1ms);
+    n_resumed++;
+}
+
+static Timer_task wait_cancellable(Timer& timer, Cancellation_token token, uint64_t& n_resumed)
+{
+    bool elapsed = co_await after(timer, 1ms, token);
+    if (elapsed) {
+        n_resumed++;
+    }
+}
+
+BENCHMARK(coroutine)
+{
+    const size_t n_tasks = context.quick() ? 10000 : 100000;
+    Benchmark_context::Values params = {{"tasks", static_cast<double>(n_tasks)}};
+    Timer::Duration fake_now = 0ns;
+    Timer timer([&]() { return fake_now; });
+    uint64_t n_resumed = 0;
+
+    // Frame allocation, scheduling and resumption of a plain delay
+    context.measure("coroutine/delay", params, n_tasks, [&]() {
+        for (size_t i = 0; i < n_tasks; i++) {
+            wait_once(timer, n_resumed);
+        }
+        fake_now += 2ms;
+        timer.process();
+    });
+
+    Cancellation_source source;
+    context.measure("coroutine/delay_cancellable", params, n_tasks, [&]() {
+        for (size_t i = 0; i < n_tasks; i++) {
+            wait_cancellable(timer, source.token(), n_resumed);
+        }
+        fake_now += 2ms;
+        timer.process();
+    });
+    do_not_optimize(n_resumed);
+
+    // Frames started here and finished on another thread, as with an executor
+    context.measure("coroutine/delay_cross_thread", params, n_tasks, [&]() {
+        for (size_t i = 0; i < n_tasks; i++) {
+            wait_once(timer, n_resumed);
+        }
+        fake_now += 2ms;
+        std::thread([&]() { timer.process(); }).join();
+    });
+    do_not_optimize(n_resumed);
+}
@@ -0,0 +1,61 @@
+#include "Benchmark.hpp"
+
+#include <sztronics/miscellaneous/Focus.hpp>
+
+#include <thread>
+#include <atomic>
+
+BENCHMARK(focus)
+{
+    const size_t n_rounds = context.quick() ? 10000 : 100000;
+
+    for (unsigned n_threads : {1u, 2u, 4u, 8u}) {
+        Benchmark_context::Values params = {{"threads", static_cast<double>(n_threads)}};
+        Focus::Focus_scope scope;
+
+        // Every thread keeps taking control from the others and handing it back
+        context.measure("focus/claim_release", params, n_threads * n_rounds, [&]() {
+            std::vector<std::thread> threads;
+            for (unsigned t = 0; t < n_threads; t++) {
+                threads.emplace_back([&]() {
+                    Focus focus(scope);
+                    for (size_t round = 0; round < n_rounds; round++) {
+                        focus.claim_control();
+                        focus.release_control();
+                    }
+                });
+            }
+            for (std::thread& thread : threads) {
+                thread.join();
+            }
+        });
+
+        // Readers polling while one thread keeps changing the controller
+        context.measure("focus/has_control_polling", params, n_threads * n_rounds * 10, [&]() {
+            std::atomic<bool> done = false;
+            std::thread writer([&]() {
+                Focus focus(scope);
+                while (!done.load(std::memory_order_relaxed)) {
+                    focus.claim_control();
+                    focus.release_control();
+                }
+            });
+            std::vector<std::thread> threads;
+            for (unsigned t = 0; t < n_threads; t++) {
+                threads.emplace_back([&]() {
+                    Focus focus(scope);
+                    size_t n_controlled = 0;
+                    for (size_t round = 0; round < n_rounds * 10; round++) {
+                        n_controlled += focus.has_control();
+                    }
+                    do_not_optimize(n_controlled);
+                });
+            }
+            for (std::thread& thread : threads) {
+                thread.join();
+            }
+            done = true;
+            writer.join();
+        });
+    }
+}
@@ -0,0 +1,69 @@
+#include "Benchmark.hpp"
+
+#include <sztronics/miscellaneous/Logger.hpp>
+
+#include <filesystem>
+#include <thread>
+
+/// @brief Runs write_line n_lines times on each of n_threads threads.
+/// @return Latency of every call; includes about one clock read of overhead.
+template <typename Write_line>
+static std::vector<uint64_t> producer_latencies(unsigned n_threads, size_t n_lines, Write_line write_line)
+{
+    std::vector<std::vector<uint64_t>> per_thread(n_threads, std::vector<uint64_t>(n_lines));
+    std::vector<std::thread> threads;
+
+    for (unsigned t = 0; t < n_threads; t++) {
+        threads.emplace_back([&, t]() {
+            std::vector<uint64_t>& latencies = per_thread[t];
+            for (size_t i = 0; i < n_lines; i++) {
+                uint64_t start = benchmark_now();
+                write_line(i);
+                latencies[i] = benchmark_now() - start;
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    std::vector<uint64_t> latencies;
+    for (std::vector<uint64_t>& thread_latencies : per_thread) {
+        latencies.insert(latencies.end(), thread_latencies.begin(), thread_latencies.end());
+    }
+    return latencies;
+}
+
+BENCHMARK(logger)
+{
+    std::string filename = (std::filesystem::temp_directory_path() / "sztronics_benchmark.log").string();
+    const size_t n_lines = context.quick() ? 10000 : 100000;
+    Logger& logger = Logger::get();
+
+    auto write_text = [](size_t i) { LOG(Info, 0) << "benchmark line " << i << " value " << i * 0.5; };
+    auto write_binary = [](size_t i) { LOG_BINARY("benchmark line {} value {}", i, i * 0.5); };
+
+    for (unsigned n_threads : {1u, 4u}) {
+        Benchmark_context::Values params = {{"threads", static_cast<double>(n_threads)}};
+
+        logger.enable(filename);
+        context.report_latencies("logger/sync_text", params, producer_latencies(n_threads, n_lines / 10, write_text));
+
+        logger.enable_async(filename, Logger::Overflow_policy::Block);
+        context.report_latencies("logger/async_text", params, producer_latencies(n_threads, n_lines, write_text));
+
+        logger.enable_async(filename, Logger::Overflow_policy::Block, LOGGER_RING_SIZE, Logger::Format::Binary);
+        context.report_latencies("logger/async_binary", params, producer_latencies(n_threads, n_lines, write_binary));
+
+        logger.enable_async(filename, Logger::Overflow_policy::Drop);
+        std::vector<uint64_t> latencies = producer_latencies(n_threads, n_lines, write_text);
+        size_t n_dropped = logger.n_dropped();
+        logger.disable();
+        context.report_latencies("logger/async_text_drop", params, std::move(latencies));
+        context.report("logger/async_text_drop_loss", params,
+                       {{"dropped", static_cast<double>(n_dropped)},
+                        {"written", static_cast<double>(n_threads * n_lines)}});
+    }
+    logger.disable();
+    std::filesystem::remove(filename);
+}
@@ -0,0 +1,94 @@
+#include "Benchmark.hpp"
+
+#include <sztronics/miscellaneous/Misc_functions.hpp>
+#include <sztronics/miscellaneous/Text_layout.hpp>
+
+#include <random>
+
+/// @return About size bytes of words of 1-12 letters, with a paragraph break every ~60 words.
+static std::string make_text(size_t size, bool utf8)
+{
+    static const char* const wide = "\xE6\xBC\xA2"; // CJK, two columns
+    std::mt19937 rng(7);
+    std::string text;
+    text.reserve(size + 16);
+
+    while (text.size() < size) {
+        size_t word_length = 1 + rng() % 12;
+        for (size_t i = 0; i < word_length; i++) {
+            if (utf8 && rng() % 8 == 0) {
+                text += wide;
+            }
+            else {
+                text += static_cast<char>('a' + rng() % 26);
+            }
+        }
+        text += rng() % 60 == 0 ? '\n' : ' ';
+    }
+    return text;
+}
+
+BENCHMARK(text)
+{
+    const size_t text_size = context.quick() ? (256 << 10) : (4 << 20);
+    std::string text = make_text(text_size, false);
+    std::string utf8_text = make_text(text_size, true);
+
+    for (int32_t width : {40, 80, 120}) {
+        Benchmark_context::Values params = {{"width", static_cast<double>(width)},
+                                            {"bytes", static_cast<double>(text.size())}};
+        context.measure("text/wrap_text", params, text.size(), [&]() {
+            std::vector<std::string> lines = wrap_text(text, width);
+            do_not_optimize(lines);
+        });
+
+        std::vector<std::string_view> views;
+        context.measure("text/wrap_text_views", params, text.size(), [&]() {
+            wrap_text_views(text, width, views);
+            do_not_optimize(views);
+        });
+        context.measure("text/wrap_text_utf8_ascii", params, text.size(), [&]() {
+            wrap_text_utf8(text, width, views);
+            do_not_optimize(views);
+        });
+
+        params[1].second = utf8_text.size();
+        context.measure("text/wrap_text_utf8", params, utf8_text.size(), [&]() {
+            wrap_text_utf8(utf8_text, width, views);
+            do_not_optimize(views);
+        });
+    }
+
+    Benchmark_context::Values params = {{"bytes", static_cast<double>(text.size())}};
+    context.measure("text/find_non_printable", params, text.size(), [&]() {
+        size_t total = 0;
+        for (size_t pos = 0; pos < text.size(); pos++) {
+            pos += find_non_printable(std::string_view(text).substr(pos));
+            total++;
+        }
+        do_not_optimize(total);
+    });
+    context.measure("text/word_prefix_length", params, text.size(), [&]() {
+        size_t total = 0;
+        for (size_t pos = 0; pos < text.size(); pos++) {
+            pos += word_prefix_length(std::string_view(text).substr(pos));
+            total++;
+        }
+        do_not_optimize(total);
+    });
+    context.measure("text/display_width", params, utf8_text.size(), [&]() {
+        size_t width = display_width(utf8_text);
+        do_not_optimize(width);
+    });
+
+    Text_layout layout(80);
+    layout.set_text(text);
+    std::mt19937 rng(11);
+    const size_t n_edits = 1000;
+    context.measure("text/layout_set_paragraph", {{"paragraphs", static_cast<double>(layout.n_paragraphs())}}, n_edits, [&]() {
+        for (size_t i = 0; i < n_edits; i++) {
+            size_t index = rng() % layout.n_paragraphs();
+            layout.set_paragraph(index, text.substr(rng() % (text.size() / 2), 200 + rng() % 400));
+        }
+    });
+}
@@ -0,0 +1,98 @@
+#include "Benchmark.hpp"
+
+#include <sztronics/miscellaneous/Timer.hpp>
+
+#include <random>
+#include <algorithm>
+
+using namespace std::chrono_literals;
+
+BENCHMARK(timer)
+{
+    // A manual clock makes every run fire the same events regardless of machine speed
+    const size_t n_ticks = context.quick() ? 2000 : 10000;
+
+    for (size_t n_events : {0, 100, 1000, 10000, 100000}) {
+        Timer::Duration fake_now = 0ns;
+        Timer timer([&]() { return fake_now; });
+        std::mt19937 rng(n_events);
+        uint64_t n_fired = 0;
+
+        for (size_t i = 0; i < n_events; i++) {
+            Timer::Duration period = std::chrono::milliseconds(1 + rng() % 10000);
+            timer.schedule(Timer::Timed_event([&]() { n_fired++; }, period));
+        }
+        context.measure_once("timer/process_wheel", {{"events", static_cast<double>(n_events)}}, n_ticks, [&]() {
+            for (size_t tick = 0; tick < n_ticks; tick++) {
+                fake_now += 1ms;
+                timer.process();
+            }
+        });
+        do_not_optimize(n_fired);
+    }
+
+    for (size_t n_events : {10, 100, 1000, 10000}) {
+        Timer::Duration fake_now = 0ns;
+        Timer timer([&]() { return fake_now; });
+        std::mt19937 rng(n_events);
+        uint64_t n_fired = 0;
+
+        for (size_t i = 0; i < n_events; i++) {
+            Timer::Duration period = std::chrono::milliseconds(1 + rng() % 10000);
+            timer.events.emplace_back([&]() { n_fired++; }, period);
+        }
+        context.measure_once("timer/process_events", {{"events", static_cast<double>(n_events)}}, n_ticks, [&]() {
+            for (size_t tick = 0; tick < n_ticks; tick++) {
+                fake_now += 1ms;
+                timer.process();
+            }
+        });
+        do_not_optimize(n_fired);
+    }
+
+    // Drift: a 60 Hz event over a simulated stretch of process() calls with jittered spacing.
+    // Lateness is the time between the ideal k-th deadline and the process() call that fired it.
+    // With skip_stalled (the default) every late fire pushes the following ones back, so drift accumulates.
+    const Timer::Duration period = 16666667ns;
+    const Timer::Duration simulated = context.quick() ? Timer::Duration(10min) : Timer::Duration(1h);
+
+    for (bool skip_stalled : {false, true}) {
+        for (bool wheel : {false, true}) {
+            Timer::Duration fake_now = 0ns;
+            Timer timer([&]() { return fake_now; });
+            timer.skip_stalled = skip_stalled;
+            std::mt19937 rng(60);
+            std::uniform_int_distribution<int64_t> step_ns(500000, 1500000);
+
+            uint64_t n_fired = 0;
+            int64_t max_late = 0;
+            double total_late = 0;
+            auto on_fire = [&]() {
+                n_fired++;
+                int64_t late = (fake_now - period * n_fired).count();
+                max_late = std::max(max_late, late);
+                total_late += late;
+            };
+            if (wheel) {
+                timer.schedule(Timer::Timed_event(on_fire, period));
+            }
+            else {
+                timer.events.emplace_back(on_fire, period);
+            }
+            while (fake_now < simulated) {
+                fake_now += Timer::Duration(step_ns(rng));
+                timer.process();
+            }
+            uint64_t expected = fake_now / period;
+            context.report(wheel ? "timer/drift_wheel" : "timer/drift_events",
+                           {{"period_ns", static_cast<double>(period.count())},
+                            {"simulated_s", static_cast<double>(std::chrono::duration_cast<std::chrono::seconds>(simulated).count())},
+                            {"skip_stalled", skip_stalled ? 1.0 : 0.0}},
+                           {{"fired", static_cast<double>(n_fired)},
+                            {"expected", static_cast<double>(expected)},
+                            {"missed", static_cast<double>(expected) - n_fired},
+                            {"max_late_ns", static_cast<double>(max_late)},
+                            {"mean_late_ns", n_fired ? total_late / n_fired : 0}});
+        }
+    }
+}
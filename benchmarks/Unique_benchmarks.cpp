@@ -0,0 +1,104 @@
+#include "Benchmark.hpp"
+
+#include <sztronics/miscellaneous/Unique.hpp>
+#include <sztronics/miscellaneous/Unique_map.hpp>
+
+#include <thread>
+#include <memory>
+
+struct Benchmark_entity : public Unique
+{
+    double value;
+    explicit Benchmark_entity(double value) : value(value) {}
+};
+
+BENCHMARK(unique)
+{
+    // Each thread repeatedly claims a batch of IDs and frees them again
+    const size_t n_rounds = context.quick() ? 2000 : 20000;
+    const size_t batch_size = 16;
+
+    for (unsigned n_threads : {1u, 2u, 4u, 8u}) {
+        Benchmark_context::Values params = {{"threads", static_cast<double>(n_threads)},
+                                            {"batch", static_cast<double>(batch_size)}};
+        context.measure("unique/construct_destroy", params, n_threads * n_rounds * batch_size, [&]() {
+            std::vector<std::thread> threads;
+            for (unsigned t = 0; t < n_threads; t++) {
+                threads.emplace_back([&]() {
+                    std::vector<Unique> batch;
+                    batch.reserve(batch_size);
+                    for (size_t round = 0; round < n_rounds; round++) {
+                        for (size_t i = 0; i < batch_size; i++) {
+                            batch.emplace_back();
+                        }
+                        batch.clear();
+                    }
+                });
+            }
+            for (std::thread& thread : threads) {
+                thread.join();
+            }
+        });
+    }
+
+    // Finding a free ID scans from the start, so cost grows with the number of live IDs
+    for (size_t n_live : {0, 1000, 4000}) {
+        std::vector<Unique> live(n_live);
+        context.measure("unique/construct_with_live", {{"live", static_cast<double>(n_live)}}, n_rounds, [&]() {
+            for (size_t round = 0; round < n_rounds; round++) {
+                Unique unique;
+                do_not_optimize(unique);
+            }
+        });
+    }
+}
+
+BENCHMARK(unique_map)
+{
+    // Bounded by UNIQUE_ENTITY_LIMIT
+    for (size_t n_elements : {64, 512, 4000}) {
+        Benchmark_context::Values params = {{"elements", static_cast<double>(n_elements)}};
+        size_t n_passes = 2000000 / n_elements;
+
+        Unique_map<std::unique_ptr<Benchmark_entity>> heap_map;
+        for (size_t i = 0; i < n_elements; i++) {
+            heap_map.emplace(std::make_unique<Benchmark_entity>(i));
+        }
+        context.measure("unique_map/iterate_unique_ptr", params, n_passes * n_elements, [&]() {
+            double sum = 0;
+            for (size_t pass = 0; pass < n_passes; pass++) {
+                for (std::unique_ptr<Benchmark_entity>& entity : heap_map) {
+                    sum += entity->value;
+                }
+            }
+            do_not_optimize(sum);
+        });
+        context.measure("unique_map/find_unique_ptr", params, n_passes * n_elements, [&]() {
+            double sum = 0;
+            for (size_t pass = 0; pass < n_passes; pass++) {
+                for (size_t key = 0; key < n_elements; key++) {
+                    auto found = heap_map.find(key);
+                    if (found != heap_map.end()) {
+                        sum += (*found)->value;
+                    }
+                }
+            }
+            do_not_optimize(sum);
+        });
+        heap_map.clear();
+
+        Unique_map<Pooled_ptr<Benchmark_entity>> pooled_map;
+        for (size_t i = 0; i < n_elements; i++) {
+            pooled_map.emplace_new(i);
+        }
+        context.measure("unique_map/iterate_pooled", params, n_passes * n_elements, [&]() {
+            double sum = 0;
+            for (size_t pass = 0; pass < n_passes; pass++) {
+                for (Pooled_ptr<Benchmark_entity>& entity : pooled_map) {
+                    sum += entity->value;
+                }
+            }
+            do_not_optimize(sum);
+        });
+    }
+}
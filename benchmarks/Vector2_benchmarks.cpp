@@ -0,0 +1,73 @@
+#include "Benchmark.hpp"
+
+#include <sztronics/miscellaneous/Vector2_array.hpp>
+
+#include <random>
+#include <cmath>
+
+BENCHMARK(vector2)
+{
+    for (size_t n_vectors : {1000, 100000, 1000000}) {
+        Benchmark_context::Values params = {{"vectors", static_cast<double>(n_vectors)}};
+        std::mt19937 rng(n_vectors);
+        std::uniform_real_distribution<float> coordinate(-100, 100);
+
+        std::vector<Vector2f> aos(n_vectors);
+        for (Vector2f& vec : aos) {
+            vec = {coordinate(rng), coordinate(rng)};
+        }
+        Vector2_array<float> soa(aos);
+        std::vector<float> lengths(n_vectors);
+        size_t n_passes = std::max<size_t>(1, 10000000 / n_vectors);
+
+        // Array of structures baseline: the loops a caller would write over std::vector<Vector2f>
+        context.measure("vector2/add_aos", params, n_passes * n_vectors, [&]() {
+            for (size_t pass = 0; pass < n_passes; pass++) {
+                for (Vector2f& vec : aos) {
+                    vec += Vector2f(0.5f, -0.5f);
+                }
+                do_not_optimize(aos[0]);
+            }
+        });
+        context.measure("vector2/add_soa", params, n_passes * n_vectors, [&]() {
+            for (size_t pass = 0; pass < n_passes; pass++) {
+                soa.add(Vector2f(0.5f, -0.5f));
+                do_not_optimize(soa.x_data()[0]);
+            }
+        });
+
+        context.measure("vector2/len_aos", params, n_passes * n_vectors, [&]() {
+            for (size_t pass = 0; pass < n_passes; pass++) {
+                for (size_t i = 0; i < n_vectors; i++) {
+                    lengths[i] = aos[i].len();
+                }
+                do_not_optimize(lengths[0]);
+            }
+        });
+        std::vector<float> soa_lengths;
+        context.measure("vector2/len_soa", params, n_passes * n_vectors, [&]() {
+            for (size_t pass = 0; pass < n_passes; pass++) {
+                soa.len(soa_lengths);
+                do_not_optimize(soa_lengths[0]);
+            }
+        });
+
+        context.measure("vector2/normalize_aos", params, n_passes * n_vectors, [&]() {
+            for (size_t pass = 0; pass < n_passes; pass++) {
+                for (Vector2f& vec : aos) {
+                    float length = std::sqrt(vec.x * vec.x + vec.y * vec.y);
+                    if (length > 0) {
+                        vec = {vec.x / length, vec.y / length};
+                    }
+                }
+                do_not_optimize(aos[0]);
+            }
+        });
+        context.measure("vector2/normalize_soa", params, n_passes * n_vectors, [&]() {
+            for (size_t pass = 0; pass < n_passes; pass++) {
+                soa.normalize();
+                do_not_optimize(soa.x_data()[0]);
+            }
+        });
+    }
+}
@@ -4,13 +4,33 @@
 #include <fstream>
 #include <optional>
 #include <filesystem>
+#include <chrono>
+#include <future>
+#include <functional>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <stdint.h>
 
 #include <sztronics/miscellaneous/Serialization.hpp>
+#include <sztronics/miscellaneous/Bloom_filter.hpp>
 
 #define DEFAULT_STORAGE_FILE "userdata.arc"
+#define ARCHIVIST_FILTER_SUFFIX ".bloom"
+#define ARCHIVIST_FILTER_MIN_CAPACITY 1024
+/// Set in an entry's locator size when an expiry time follows the header.
+/// Files written before expiry support that hold locators of 32768 bytes or more are misread.
+#define ARCHIVIST_EXPIRY_FLAG 0x8000
+#define ARCHIVIST_MAX_LOCATOR_SIZE 0x7FFF
+/// Number of expired entries found by reads that triggers purge_expired().
+#define ARCHIVIST_PURGE_THRESHOLD 64
+/// Entries Snapshot::for_each() reads per lock of the file.
+#define ARCHIVIST_SNAPSHOT_BATCH 256
 
 /// @brief Manages long-term variable storage by writing
 ///        and reading key-value pairs from a file.
+///        Thread-safe; the *_async methods run on a background I/O thread started on first use.
 
 // todo: make search log(n)
 class Archivist
@@ -22,14 +42,106 @@ class Archivist
     int n_entries;
     std::fstream file;
 
+    /// Locators of every entry, so that lookups of missing locators skip the file scan.
+    /// Persisted in <filename>.bloom and rebuilt when that doesn't match the file.
+    Bloom_filter locator_filter;
+    /// Locators deleted since the filter was built; their bits stay set until the next rebuild.
+    int n_filter_stale = 0;
+
+    /// @brief Loads the filter saved next to the file, or rebuilds it if it is missing or out of date.
+    void load_filter();
+    /// @brief Rebuilds the filter from every locator in the file.
+    void rebuild_filter();
+    /// @brief Rebuilds the filter if it holds more locators (live or deleted) than it was sized for.
+    void maintain_filter();
+    /// @brief Writes the filter next to the file, stamped with the file's size and modification time.
+    void save_filter();
+
     /// @brief Single locator-data pair from a file.
     struct Storage_entry
     {   
-        // + uint16 locator_size
+        // + uint16 locator_size (| ARCHIVIST_EXPIRY_FLAG if expires_at is stored)
         // + uint data_size
+        // + uint64 expires_at, if flagged
         std::string locator;
         std::vector<char> data;
+        uint64_t expires_at = 0;
+    };
+
+    /// @brief Fixed-size part of an entry, before its locator.
+    struct Entry_header
+    {
+        unsigned short locator_size; // Without ARCHIVIST_EXPIRY_FLAG
+        unsigned int data_size;
+        uint64_t expires_at = 0;     // Milliseconds since the Unix epoch; 0 if the entry doesn't expire
+
+        inline unsigned size() const 
+        { 
+            return sizeof(unsigned short) + sizeof(unsigned int) + (expires_at ? sizeof(uint64_t) : 0); 
+        }
+        inline bool expired(uint64_t now_ms) const { return expires_at != 0 && expires_at <= now_ms; }
     };
+
+    /// Expired entries found by get_raw() since the last purge.
+    int n_expired_seen = 0;
+
+    static uint64_t now_ms();
+
+    /// @brief Reads the header of the entry at the current read position.
+    /// @return Whether it was read completely.
+    bool read_header(Entry_header& header);
+
+    /// Guards the file and everything describing it. Public methods take it;
+    /// the private helpers below expect it to be held already.
+    std::mutex state_mutex;
+
+    struct Io_request;
+    struct Io_worker;
+    /// Created by the first *_async call, under state_mutex.
+    std::unique_ptr<Io_worker> io_worker;
+
+    /// @brief Starts the I/O thread if needed and queues request for it. Expects state_mutex to be held.
+    void enqueue(Io_request request);
+    /// @brief Runs on the I/O thread with the result of a read, or the exception it threw.
+    using Read_completion = std::function<void(std::optional<Serialized>& result, std::exception_ptr error)>;
+    /// @brief get_raw_async() that hands the result to completion instead of a future.
+    void get_raw_async(std::string locator, Read_completion completion);
+    /// @brief Body of the I/O thread: takes every queued request at once and resolves
+    ///        each run of consecutive reads in a single pass over the file.
+    void run_io_worker();
+
+    std::optional<Serialized> get_entry(std::string locator);
+    /// @brief Finds every given locator in one pass over the file.
+    /// @param results Set to the data of each locator, or nothing if it is missing or expired.
+    void get_entries(const std::vector<std::string>& locators, std::vector<std::optional<Serialized>>& results);
+    /// @brief Counts expired entries found by a read and purges once there are enough of them,
+    ///        on the I/O thread if it is running. Call it after the read is done with the file.
+    void expired_entry_seen(int n_seen = 1);
+    bool del_entry(std::string locator);
+    int purge_entries();
+    /// @brief After a read failed mid-purge, covers the bytes between the slid entries at write_pos and the
+    ///        untouched ones at read_pos with one expired entry, so the rest of the file stays reachable.
+    void seal_purge_gap(unsigned write_pos, unsigned read_pos, int n_removed);
+
+    struct Snapshot_state;
+    /// Every snapshot taken, including destroyed ones not yet forgotten.
+    std::vector<std::weak_ptr<Snapshot_state>> snapshots;
+    /// Incremented whenever entries move within the file, so Snapshot::for_each() knows to rescan.
+    uint64_t layout_version = 0;
+
+    /// @return Live snapshots that haven't preserved locator yet. Forgets destroyed snapshots.
+    std::vector<std::shared_ptr<Snapshot_state>> snapshots_missing(const std::string& locator);
+    /// @brief Copies the current value of locator into every live snapshot that doesn't have one yet.
+    ///        Called before any write to it.
+    /// @param location, header Where locate_entry() found the entry, if it did.
+    void preserve_for_snapshots(const std::string& locator, std::optional<unsigned> location, 
+                                const Entry_header& header);
+    /// @brief Copies an entry removed by purge_entries() into the snapshots taken before it expired.
+    void preserve_expired(const Storage_entry& entry);
+
+    /// @brief Creates or overwrites an entry.
+    /// @param expires_at Milliseconds since the Unix epoch, or 0 if the entry doesn't expire.
+    bool put_entry(std::string locator, Serialized value, uint64_t expires_at);
     /// @brief Writes given entry over file contents, starting from given position.
     /// @warning Does NOT relocate contents if new entry overlaps with the next one.
     /// @return Whether no files occurred when interacting with file.
@@ -44,9 +156,10 @@ class Archivist
     /// @return Serialized contents of the entry or nothing if an error occurred.
     std::optional<Serialized> read_entry_at(unsigned at_pos);
 
-    /// @brief Locates an entry by its Locator.
+    /// @brief Locates an entry by its Locator, expired or not.
+    /// @param found_header Set to the entry's header if it is found.
     /// @return Position of entry or nothing if no such entry exists.
-    std::optional<unsigned int> locate_entry(std::string locator);
+    std::optional<unsigned int> locate_entry(std::string locator, Entry_header* found_header = nullptr);
 
     /// @brief Locate n-th entry from file start.
     /// @return Position of entry or nothing if EOF is reached.
@@ -60,16 +173,35 @@ class Archivist
     static Archivist& get_default();
     
     /// @brief Retreives serialized data marked with given Locator.
+    ///        Expired entries read as missing.
     std::optional<Serialized> get_raw(std::string locator);
 
     /// @brief Creates or overwrites an entry with given Locator.
     /// @return
     bool put_raw(std::string locator, Serialized value);
 
+    /// @brief Creates or overwrites an entry that expires ttl from now (by the system clock,
+    ///        so expiry survives restarts). Locators are limited to ARCHIVIST_MAX_LOCATOR_SIZE bytes.
+    bool put_raw(std::string locator, Serialized value, std::chrono::milliseconds ttl);
+
     /// @brief Deletes data marked with given Locator.
     /// @return 
     bool del(std::string locator);
 
+    /// @brief Retreives data of several Locators in a single pass over the file.
+    /// @return Data of each Locator in the same order; nothing for missing or expired ones.
+    std::vector<std::optional<Serialized>> get_many_raw(const std::vector<std::string>& locators);
+
+    /// @brief get_raw() on the I/O thread. Reads queued together are resolved
+    ///        in one pass over the file. Requests complete in the order they were made.
+    std::future<std::optional<Serialized>> get_raw_async(std::string locator);
+    /// @brief put_raw() on the I/O thread.
+    std::future<bool> put_raw_async(std::string locator, Serialized value);
+    /// @brief put_raw() with a ttl on the I/O thread; the expiry time is taken now.
+    std::future<bool> put_raw_async(std::string locator, Serialized value, std::chrono::milliseconds ttl);
+    /// @brief del() on the I/O thread.
+    std::future<bool> del_async(std::string locator);
+
     template <typename Type>
     inline std::optional<Type> get(std::string locator)
     {
@@ -80,11 +212,121 @@ class Archivist
         return { deserialize<Type>(serialized.value()) };
     }
 
+    template <typename Type>
+    inline std::vector<std::optional<Type>> get_many(const std::vector<std::string>& locators)
+    {
+        std::vector<std::optional<Type>> values;
+        values.reserve(locators.size());
+        for (std::optional<Serialized>& serialized : get_many_raw(locators)) {
+            if (serialized.has_value()) {
+                values.emplace_back(deserialize<Type>(serialized.value()));
+            }
+            else {
+                values.emplace_back();
+            }
+        }
+        return values;
+    }
+
+    /// @brief get() on the I/O thread, deserialization included, so the future turns ready by itself.
+    template <typename Type>
+    inline std::future<std::optional<Type>> get_async(std::string locator)
+    {
+        // Shared, as std::function needs a copyable callable
+        auto promise = std::make_shared<std::promise<std::optional<Type>>>();
+        std::future<std::optional<Type>> result = promise->get_future();
+        get_raw_async(std::move(locator), [promise](std::optional<Serialized>& serialized, std::exception_ptr error) {
+            try {
+                if (error) {
+                    std::rethrow_exception(error);
+                }
+                if (!serialized.has_value()) {
+                    promise->set_value({});
+                    return;
+                }
+                promise->set_value(deserialize<Type>(serialized.value()));
+            }
+            catch (...) {
+                promise->set_exception(std::current_exception());
+            }
+        });
+        return result;
+    }
+
     template <typename Type>
     inline bool put(std::string locator, Type value)
     {
         Serialized serialized = serialize(value);
         return put_raw(locator, serialized);
     }
+
+    template <typename Type>
+    inline bool put(std::string locator, Type value, std::chrono::milliseconds ttl)
+    {
+        Serialized serialized = serialize(value);
+        return put_raw(locator, serialized, ttl);
+    }
+
+    /// @brief Serializes value on the calling thread and writes it on the I/O thread.
+    template <typename Type>
+    inline std::future<bool> put_async(std::string locator, Type value)
+    {
+        return put_raw_async(locator, serialize(value));
+    }
+
+    template <typename Type>
+    inline std::future<bool> put_async(std::string locator, Type value, std::chrono::milliseconds ttl)
+    {
+        return put_raw_async(locator, serialize(value), ttl);
+    }
+
+    /// @brief Removes every expired entry in a single rewrite of the file.
+    ///        Runs by itself once reads have found ARCHIVIST_PURGE_THRESHOLD expired entries,
+    ///        in the background if the I/O thread is running.
+    /// @return Number of entries removed, or -1 if the file could not be written.
+    int purge_expired();
+
+    /// @brief Frozen view of the store as it was when Archivist::snapshot() was called.
+    ///        Writes made afterwards copy the values they replace into the snapshot,
+    ///        so it costs nothing until then. Expiry is judged at the time the snapshot was taken.
+    /// @warning Must not outlive the Archivist it was taken from.
+    class Snapshot
+    {
+        private:
+        friend class Archivist;
+        Archivist* archivist;
+        std::shared_ptr<Snapshot_state> state;
+
+        Snapshot(Archivist& archivist, std::shared_ptr<Snapshot_state> state);
+        /// @brief Runs fn for every entry live at the time of the snapshot, once each, in no particular order.
+        ///        The file is locked in batches of ARCHIVIST_SNAPSHOT_BATCH entries, not during fn.
+        void visit(const std::function<void(const Storage_entry&)>& fn);
+
+        public:
+        std::optional<Serialized> get_raw(std::string locator);
+
+        template <typename Type>
+        inline std::optional<Type> get(std::string locator)
+        {
+            std::optional<Serialized> serialized = get_raw(locator);
+            if (!serialized.has_value()) {
+                return {};
+            }
+            return { deserialize<Type>(serialized.value()) };
+        }
+
+        /// @brief Runs fn for every entry of the snapshot, in no particular order, while writers continue.
+        void for_each(const std::function<void(const std::string& locator, const Serialized& value)>& fn);
+
+        /// @brief Writes the snapshot to a new storage file that Archivist can open.
+        /// @return Whether it was written completely.
+        bool save_as(std::string storage_file);
+
+        /// @return Milliseconds since the Unix epoch when the snapshot was taken.
+        uint64_t get_time() const;
+    };
+
+    /// @brief Takes a snapshot in constant time.
+    Snapshot snapshot();
     // void flush();
 };
\ No newline at end of file
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <vector>
+#include <string_view>
+#include <algorithm>
+#include <utility>
+#include <cmath>
+#include <stdint.h>
+
+#define BLOOM_FILTER_BITS_PER_ITEM 10
+
+/// @brief Set membership test without false negatives: may_contain() is always true for
+///        inserted keys, and true for other keys with a small probability
+///        (about 1% at BLOOM_FILTER_BITS_PER_ITEM bits per item, until capacity is exceeded).
+///        Keys cannot be removed; rebuild the filter instead.
+class Bloom_filter
+{
+    private:
+    std::vector<uint64_t> words;
+    uint64_t bit_mask = 0;   // Number of bits - 1; always a power of two
+    uint32_t n_hashes = 1;
+    size_t capacity = 0;
+
+    /// @brief Two independent 64-bit hashes of a key: FNV-1a and a splitmix64 finalizer of it.
+    static inline void hash(std::string_view key, uint64_t& h1, uint64_t& h2)
+    {
+        uint64_t h = 14695981039346656037ull;
+        for (char ch : key) {
+            h = (h ^ static_cast<unsigned char>(ch)) * 1099511628211ull;
+        }
+        h1 = h;
+        h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+        h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+        h2 = (h ^ (h >> 31)) | 1; // Odd, so probes don't repeat within the table
+    }
+
+    public:
+    /// @param capacity Number of keys the filter is sized for.
+    explicit Bloom_filter(size_t capacity = 0, uint32_t bits_per_item = BLOOM_FILTER_BITS_PER_ITEM)
+    {
+        reset(capacity, bits_per_item);
+    }
+
+    /// @brief Empties the filter and resizes it for capacity keys.
+    void reset(size_t capacity, uint32_t bits_per_item = BLOOM_FILTER_BITS_PER_ITEM)
+    {
+        uint64_t n_bits = 64;
+        while (n_bits < static_cast<uint64_t>(capacity) * bits_per_item) {
+            n_bits <<= 1;
+        }
+        words.assign(n_bits / 64, 0);
+        bit_mask = n_bits - 1;
+        // k = ln 2 * bits per item minimizes the false positive rate
+        n_hashes = std::max<uint32_t>(1, static_cast<uint32_t>(std::lround(bits_per_item * 0.6931)));
+        this->capacity = capacity;
+    }
+
+    /// @brief Restores a filter saved through get_words() and get_n_hashes().
+    /// @return Whether the data describes a valid filter; if not, the filter is left unchanged.
+    bool assign(std::vector<uint64_t> saved_words, uint32_t saved_n_hashes, size_t saved_capacity)
+    {
+        size_t n_words = saved_words.size();
+        if (n_words == 0 || (n_words & (n_words - 1)) != 0 || saved_n_hashes == 0) {
+            return false;
+        }
+        words = std::move(saved_words);
+        bit_mask = n_words * 64 - 1;
+        n_hashes = saved_n_hashes;
+        capacity = saved_capacity;
+        return true;
+    }
+
+    void insert(std::string_view key)
+    {
+        uint64_t h1, h2;
+        hash(key, h1, h2);
+        for (uint32_t i = 0; i < n_hashes; i++) {
+            uint64_t bit = (h1 + i * h2) & bit_mask;
+            words[bit / 64] |= uint64_t(1) << (bit % 64);
+        }
+    }
+
+    /// @return False if key was never inserted.
+    bool may_contain(std::string_view key) const
+    {
+        uint64_t h1, h2;
+        hash(key, h1, h2);
+        for (uint32_t i = 0; i < n_hashes; i++) {
+            uint64_t bit = (h1 + i * h2) & bit_mask;
+            if ((words[bit / 64] & (uint64_t(1) << (bit % 64))) == 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    inline size_t get_capacity() const { return capacity; }
+    inline uint32_t get_n_hashes() const { return n_hashes; }
+    inline const std::vector<uint64_t>& get_words() const { return words; }
+};
@@ -1,8 +1,12 @@
 #pragma once
 
 #include <optional>
-#include <mutex>
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <vector>
+#include <deque>
+#include <functional>
 
 class Focus
 {
@@ -10,23 +14,84 @@ class Focus
     class Focus_scope
     {
         public:
-        std::mutex focus_mutex;
-        std::optional<std::reference_wrapper<Focus>> current_controller;
+        /// @brief Called after control moved from previous to current; either can be nullptr.
+        using Subscriber = std::function<void(Focus* previous, Focus* current)>;
+
+        /// Lock-free, so that polling has_control() never blocks.
+        std::atomic<Focus*> current_controller = nullptr;
         std::optional<std::reference_wrapper<Focus>> get_controller();
+
+        /// @return ID for unsubscribe().
+        size_t subscribe(Subscriber subscriber);
+        void unsubscribe(size_t id);
+
+        private:
+        friend class Focus;
+
+        std::mutex focus_mutex; // Only taken by changes; readers use current_controller
+        /// Focuses waiting for control, ordered by priority, then by claim order. The last one is the controller.
+        std::vector<Focus*> stack;
+        std::vector<std::pair<size_t, Subscriber>> subscribers;
+        size_t subscriber_counter = 0;
+
+        /// @brief Controller change waiting for its callbacks to run.
+        struct Change
+        {
+            Focus* previous;
+            Focus* current;
+            std::function<void(void)> lose_callback;
+            std::function<void(void)> gain_callback;
+            std::vector<std::pair<size_t, Subscriber>> subscribers;
+        };
+        std::deque<Change> pending_changes; // In the order the changes happened
+        bool delivering = false;            // Some thread is running callbacks of pending_changes
+
+        void push(Focus& focus);
+        /// @return Whether the focus was on the stack.
+        bool remove(Focus& focus);
+        /// @brief Makes the top of the stack the controller and runs the callbacks after unlocking.
+        void update_controller(std::unique_lock<std::mutex>& lock);
+        /// @brief Tells subscribers that a focus moved to another address while keeping its place.
+        void notify_moved(std::unique_lock<std::mutex>& lock, Focus* from, Focus* to);
+        /// @brief Runs callbacks of pending changes one change at a time, unless another thread already does.
+        void deliver(std::unique_lock<std::mutex>& lock);
     };
 
     static Focus_scope global_scope;
 
-    Focus(Focus_scope& focus_space = global_scope);
-    bool has_control();
+    /// @brief Takes control if nobody in the scope has it.
+    /// @param priority Control goes to the focus with the highest priority that claimed it.
+    Focus(Focus_scope& focus_space = global_scope, int priority = 0);
+    /// @brief Releases control if this holds it.
+    ~Focus();
+
+    /// @return Whether this is the controller of its scope. A single atomic load.
+    inline bool has_control() const { return focus_space.current_controller.load(std::memory_order_acquire) == this; }
+    /// @brief Takes control from the current controller, unless it has higher priority.
+    ///        In that case, this gets control once every focus above it releases it.
     void claim_control();
+    /// @brief Takes control only if nobody has it.
+    /// @return Whether this has control now.
+    bool try_claim_control();
+    /// @brief Gives control back to the previous claimant, or stops waiting for it.
+    void release_control();
+
+    inline int get_priority() const { return priority; }
+
+    /// @brief Callbacks run without any lock held, one change at a time and in the order of the changes.
+    ///        Usually on the thread that caused the change; if another thread is running callbacks
+    ///        at that moment, it runs these too, after the earlier ones.
+    void on_gain(std::function<void(void)> callback);
+    void on_lose(std::function<void(void)> callback);
 
     Focus& operator= (Focus&& other);
     Focus(Focus&& other);
     
     private:
-    bool control;
     Focus(const Focus& other) = delete;
     Focus& operator= (Focus& other) = delete;
     Focus_scope& focus_space;    
+    int priority;
+    std::function<void(void)> gain_callback;
+    std::function<void(void)> lose_callback;
 };
\ No newline at end of file
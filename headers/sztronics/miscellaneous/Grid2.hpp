@@ -0,0 +1,310 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <stdexcept>
+#include <utility>
+#include <type_traits>
+#include <algorithm>
+#include <stdint.h>
+
+#include <sztronics/miscellaneous/Vector2.hpp>
+#include <sztronics/miscellaneous/Misc_functions.hpp>
+
+/// @brief Memory layout of Grid2 cells.
+enum class Grid2_layout
+{
+    Row_major, /// Same as to_1d(): rows one after another.
+    Tiled,     /// Square tiles stored one after another, row-major inside each tile.
+    Morton     /// Z-order curve; neighbours in both directions are close in memory.
+};
+
+/// @brief 2D array indexed by Vector2i, with x as row and y as column (like to_1d()).
+///        Tiled and Morton layouts keep 2D neighbourhoods close in memory,
+///        so neighbour operations on large maps don't stride across whole rows.
+template <typename T, Grid2_layout Layout = Grid2_layout::Row_major>
+class Grid2
+{
+    // std::vector<bool> can't hand out references to cells, and packs cells of
+    // neighbouring tiles into shared words, which parallel_for_each_tile() would race on
+    static_assert(!std::is_same<T, bool>::value, "Grid2 doesn't support bool cells; use uint8_t instead.");
+
+    public:
+    /// @brief Side of a square tile used by Tiled layout and by tile iteration.
+    static constexpr int32_t tile_size = 8;
+
+    private:
+    Vector2i dimensions;
+    std::vector<T> cells;
+    uint32_t tiles_per_row = 0;  // Tiled
+    uint32_t morton_bits_x = 0;  // Morton: log2 of padded size in each direction
+    uint32_t morton_bits_y = 0;
+
+    /// @brief Spreads lower 16 bits of value into even bits.
+    static constexpr inline uint32_t spread_bits(uint32_t value)
+    {
+        value &= 0x0000ffff;
+        value = (value | (value << 8)) & 0x00ff00ff;
+        value = (value | (value << 4)) & 0x0f0f0f0f;
+        value = (value | (value << 2)) & 0x33333333;
+        value = (value | (value << 1)) & 0x55555555;
+        return value;
+    }
+
+    static constexpr inline uint32_t ceil_log2(uint32_t value)
+    {
+        uint32_t bits = 0;
+        while ((1u << bits) < value) {
+            bits++;
+        }
+        return bits;
+    }
+
+    public:
+    Grid2(Vector2i size = {0, 0}, const T& value = T()) : dimensions(size)
+    {
+        if (size.x < 0 || size.y < 0) {
+            throw std::invalid_argument("Grid2(): negative size");
+        }
+        size_t n_cells = static_cast<size_t>(size.x) * size.y;
+
+        if constexpr (Layout == Grid2_layout::Tiled) {
+            tiles_per_row = (size.y + tile_size - 1) / tile_size;
+            n_cells = static_cast<size_t>((size.x + tile_size - 1) / tile_size) * tiles_per_row * tile_size * tile_size;
+        }
+        else if constexpr (Layout == Grid2_layout::Morton) {
+            morton_bits_x = ceil_log2(size.x);
+            morton_bits_y = ceil_log2(size.y);
+            if (morton_bits_x > 16 || morton_bits_y > 16) {
+                throw std::invalid_argument("Grid2(): Morton layout supports up to 65536 cells per side");
+            }
+            n_cells = (size.x == 0 || size.y == 0) ? 0 : size_t(1) << (morton_bits_x + morton_bits_y);
+        }
+        cells.assign(n_cells, value);
+    }
+
+    inline Vector2i size() const { return dimensions; }
+
+    /// @return Whether index lies within the grid.
+    inline bool in_bounds(Vector2i index) const { return index >= Vector2i(0, 0) && index < dimensions; }
+
+    /// @brief Maps a 2D index to position in underlying storage.
+    /// @warning Does not check bounds.
+    inline size_t index_of(Vector2i index) const
+    {
+        if constexpr (Layout == Grid2_layout::Row_major) {
+            return static_cast<size_t>(to_1d(index, dimensions.y));
+        }
+        else if constexpr (Layout == Grid2_layout::Tiled) {
+            size_t tile = static_cast<size_t>(index.x / tile_size) * tiles_per_row + index.y / tile_size;
+            return tile * (tile_size * tile_size) + to_1d(index.x % tile_size, index.y % tile_size, tile_size);
+        }
+        else {
+            // Interleave the bits both coordinates have, then append the rest of the longer one
+            uint32_t shared_bits = std::min(morton_bits_x, morton_bits_y);
+            uint32_t mask = (1u << shared_bits) - 1;
+            uint32_t x = static_cast<uint32_t>(index.x);
+            uint32_t y = static_cast<uint32_t>(index.y);
+
+            size_t z_index = (spread_bits(x & mask) << 1) | spread_bits(y & mask);
+            return z_index | ((static_cast<size_t>(x >> shared_bits) | (y >> shared_bits)) << (2 * shared_bits));
+        }
+    }
+
+    inline T& operator[](Vector2i index) { return cells[index_of(index)]; }
+    inline const T& operator[](Vector2i index) const { return cells[index_of(index)]; }
+
+    /// @brief Bounds-checked access.
+    T& at(Vector2i index)
+    {
+        if (!in_bounds(index)) {
+            throw std::out_of_range("Grid2::at(): index " + std::to_string(index) + " is out of bounds");
+        }
+        return cells[index_of(index)];
+    }
+    const T& at(Vector2i index) const { return const_cast<Grid2*>(this)->at(index); }
+
+    /// @brief Access with index clamped to the grid, like Vector2::clamp.
+    inline T& at_clamped(Vector2i index) { return cells[index_of(index.clamp(dimensions))]; }
+    inline const T& at_clamped(Vector2i index) const { return cells[index_of(index.clamp(dimensions))]; }
+
+    inline void fill(const T& value) { std::fill(cells.begin(), cells.end(), value); }
+
+    /// @brief Calls fn(Vector2i index, T& cell) for every cell of a row.
+    template <typename Function>
+    void for_each_in_row(int32_t row, Function fn)
+    {
+        for (int32_t column = 0; column < dimensions.y; column++) {
+            fn(Vector2i(row, column), (*this)[{row, column}]);
+        }
+    }
+
+    /// @brief Calls fn(Vector2i lower, Vector2i upper) for every tile.
+    ///        Tiles cover [lower, upper) and are clipped to the grid.
+    template <typename Function>
+    void for_each_tile(Function fn) const
+    {
+        for (int32_t x = 0; x < dimensions.x; x += tile_size) {
+            for (int32_t y = 0; y < dimensions.y; y += tile_size) {
+                fn(Vector2i(x, y), Vector2i(std::min(x + tile_size, dimensions.x), 
+                                            std::min(y + tile_size, dimensions.y)));
+            }
+        }
+    }
+
+    /// @brief Calls fn(Vector2i index, T& cell) for every cell in an order that follows memory layout.
+    template <typename Function>
+    void for_each(Function fn)
+    {
+        if constexpr (Layout == Grid2_layout::Row_major) {
+            for (int32_t row = 0; row < dimensions.x; row++) {
+                for_each_in_row(row, fn);
+            }
+        }
+        else {
+            for_each_tile([&](Vector2i lower, Vector2i upper) {
+                for (int32_t x = lower.x; x < upper.x; x++) {
+                    for (int32_t y = lower.y; y < upper.y; y++) {
+                        fn(Vector2i(x, y), (*this)[{x, y}]);
+                    }
+                }
+            });
+        }
+    }
+
+    /// @brief Runs fn(Vector2i lower, Vector2i upper) for every tile on a pool of threads.
+    ///        fn must only write to cells within its own tile.
+    /// @param n_threads Number of threads to use; 0 picks hardware concurrency.
+    template <typename Function>
+    void parallel_for_each_tile(Function fn, unsigned n_threads = 0) const
+    {
+        int32_t tiles_x = (dimensions.x + tile_size - 1) / tile_size;
+        int32_t tiles_y = (dimensions.y + tile_size - 1) / tile_size;
+        int32_t n_tiles = tiles_x * tiles_y;
+
+        if (n_threads == 0) {
+            n_threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        n_threads = std::min<unsigned>(n_threads, std::max(n_tiles, 1));
+
+        std::atomic<int32_t> next_tile = 0;
+        std::exception_ptr error;
+        std::atomic_flag error_set = ATOMIC_FLAG_INIT;
+
+        auto worker = [&]() {
+            try {
+                for (int32_t tile = next_tile++; tile < n_tiles; tile = next_tile++) {
+                    Vector2i lower = Vector2i(tile / tiles_y, tile % tiles_y) * tile_size;
+                    fn(lower, Vector2i(std::min(lower.x + tile_size, dimensions.x), 
+                                       std::min(lower.y + tile_size, dimensions.y)));
+                }
+            }
+            catch (...) { // Stop handing out tiles and rethrow on the calling thread
+                next_tile = n_tiles;
+                if (!error_set.test_and_set()) {
+                    error = std::current_exception();
+                }
+            }
+        };
+        std::vector<std::thread> threads;
+        for (unsigned i = 1; i < n_threads; i++) {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    /// @brief Finds all cells connected to start for which predicate(cell) holds.
+    /// @param diagonal Whether diagonal neighbours are connected.
+    /// @return Indices of region cells, or nothing if start is out of bounds or doesn't satisfy predicate.
+    ///         Only callables take part, so flood_fill(start, 1) fills a Grid2<uint8_t> instead of landing here.
+    template <typename Predicate, 
+              typename = std::enable_if_t<std::is_invocable_r<bool, Predicate&, const T&>::value>>
+    std::vector<Vector2i> flood_fill(Vector2i start, Predicate predicate, bool diagonal = false) const
+    {
+        std::vector<Vector2i> region;
+        if (!in_bounds(start) || !predicate((*this)[start])) {
+            return region;
+        }
+        static const Vector2i neighbours[] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}, 
+                                              {-1, -1}, {-1, 1}, {1, -1}, {1, 1}};
+        int n_neighbours = diagonal ? 8 : 4;
+
+        std::vector<bool> visited(static_cast<size_t>(dimensions.x) * dimensions.y, false);
+        visited[to_1d(start, dimensions.y)] = true;
+        region.push_back(start);
+
+        // region doubles as the BFS queue
+        for (size_t head = 0; head < region.size(); head++) {
+            for (int i = 0; i < n_neighbours; i++) {
+                Vector2i next = region[head] + neighbours[i];
+                if (!in_bounds(next) || visited[to_1d(next, dimensions.y)]) {
+                    continue;
+                }
+                visited[to_1d(next, dimensions.y)] = true;
+                if (predicate((*this)[next])) {
+                    region.push_back(next);
+                }
+            }
+        }
+        return region;
+    }
+
+    /// @brief Replaces the connected region of cells equal to the start cell with value.
+    /// @return Number of cells changed.
+    size_t flood_fill(Vector2i start, const T& value, bool diagonal = false)
+    {
+        if (!in_bounds(start)) {
+            return 0;
+        }
+        T original = (*this)[start];
+        std::vector<Vector2i> region = flood_fill(start, [&](const T& cell) { return cell == original; }, diagonal);
+        for (Vector2i index : region) {
+            (*this)[index] = value;
+        }
+        return region.size();
+    }
+
+    /// @brief Convolves the grid with a kernel centered at kernel.size() / 2:
+    ///        result[i] = sum of grid[i + center - k] * kernel[k]. The kernel is flipped,
+    ///        as in mathematical convolution; symmetric kernels give the same result either way.
+    ///        Cells outside the grid are taken from the nearest edge.
+    /// @param n_threads Threads to process tiles with; 1 processes on the calling thread, 0 picks automatically.
+    template <typename Kernel_type, Grid2_layout Kernel_layout>
+    Grid2<T, Layout> convolve(const Grid2<Kernel_type, Kernel_layout>& kernel, unsigned n_threads = 1) const
+    {
+        using Accumulator = decltype(std::declval<T>() * std::declval<Kernel_type>());
+
+        Grid2<T, Layout> result(dimensions);
+        Vector2i center = kernel.size() / 2;
+
+        auto process_tile = [&](Vector2i lower, Vector2i upper) {
+            for (int32_t x = lower.x; x < upper.x; x++) {
+                for (int32_t y = lower.y; y < upper.y; y++) {
+                    Accumulator sum = Accumulator();
+                    for (int32_t kx = 0; kx < kernel.size().x; kx++) {
+                        for (int32_t ky = 0; ky < kernel.size().y; ky++) {
+                            Vector2i source = Vector2i(x - kx, y - ky) + center;
+                            sum += at_clamped(source) * kernel[{kx, ky}];
+                        }
+                    }
+                    result[{x, y}] = static_cast<T>(sum);
+                }
+            }
+        };
+        if (n_threads == 1) {
+            for_each_tile(process_tile);
+        }
+        else {
+            parallel_for_each_tile(process_tile, n_threads);
+        }
+        return result;
+    }
+};
@@ -4,30 +4,375 @@
 #include <fstream>
 #include <string>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <string_view>
+#include <type_traits>
+#include <algorithm>
+#include <cstring>
+#include <chrono>
+#include <stdint.h>
+
+#include <sztronics/miscellaneous/Serialization.hpp>
+
+#define LOGGER_RING_SIZE 65536
+#define LOGGER_MAX_CATEGORIES 64
+#define LOGGER_SEGMENT_SIZE (64 << 20)
+#define LOGGER_CRASH_RECORDS 256
+#define LOGGER_CRASH_RECORD_SIZE 256
+
+/// Levels below this are compiled out of LOG() statements entirely (0 = Trace ... 6 = Off).
+#ifndef LOGGER_MIN_LEVEL
+#define LOGGER_MIN_LEVEL 0
+#endif
+
+enum class Log_level : uint8_t
+{
+    Trace, Debug, Info, Warning, Error, Fatal, Off
+};
+
+// Spelled out only when something is compiled out, since level >= 0 always holds
+#if LOGGER_MIN_LEVEL > 0
+#define LOGGER_COMPILED_IN(level) (static_cast<int>(Log_level::level) >= LOGGER_MIN_LEVEL)
+#else
+#define LOGGER_COMPILED_IN(level) true
+#endif
+
+/// @brief Writes one line: LOG(Info, category) << "x = " << x;
+///        Nothing after LOG() is evaluated when the level is filtered out,
+///        and below LOGGER_MIN_LEVEL the whole statement is removed at compile time.
+#define LOG(level, category) \
+    if (!(LOGGER_COMPILED_IN(level) && \
+          Logger::get().enabled(Log_level::level, category))) {} \
+    else Logger::Line(Log_level::level, category)
+
+/// @brief LOG() that writes at most max_per_second lines per second from this call site.
+///        The next line written reports how many were suppressed in between.
+#define LOG_RATE_LIMITED(level, category, max_per_second) \
+    if (!(LOGGER_COMPILED_IN(level) && \
+          Logger::get().enabled(Log_level::level, category))) {} \
+    else if (static Log_rate_limiter sz_log_limiter(max_per_second); !sz_log_limiter.allow()) {} \
+    else Logger::Line(Log_level::level, category, sz_log_limiter.take_suppressed())
+
+/// @brief Records a line in binary form: a format string ID and raw argument bytes.
+///        Formatting happens later, in Logger::decode(). Every "{}" in format is replaced
+///        by the next argument. Format must be a string literal.
+#define LOG_BINARY_AT(level, category, format, ...) \
+    do { \
+        if (LOGGER_COMPILED_IN(level) && \
+            Logger::get().enabled(Log_level::level, category)) { \
+            static std::atomic<uint32_t> sz_log_format_id = 0; \
+            Logger::get().write_binary(sz_log_format_id, Log_level::level, category, \
+                                       format, __FILE__, __LINE__, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+#define LOG_BINARY(format, ...) LOG_BINARY_AT(Info, 0, format, ##__VA_ARGS__)
+
+/// @brief Fixed one-second window limiter for a single call site.
+class Log_rate_limiter
+{
+    private:
+    const uint32_t max_per_second;
+    std::atomic<int64_t> window_start{0}; // Steady clock, nanoseconds
+    std::atomic<uint32_t> n_in_window{0};
+    std::atomic<size_t> n_suppressed{0};
+
+    public:
+    explicit Log_rate_limiter(uint32_t max_per_second) : max_per_second(max_per_second) {}
+
+    /// @return Whether another line may be written now.
+    bool allow();
+    /// @return Number of lines suppressed since the last call.
+    inline size_t take_suppressed() { return n_suppressed.exchange(0, std::memory_order_relaxed); }
+};
 
 class Logger
 {
     public:
+    /// @brief What an async producer does when its buffer is full.
+    enum class Overflow_policy
+    {
+        Block, /// Wait for the background thread to make room.
+        Drop,  /// Discard the record.
+        Count  /// Discard the record and report the number of dropped records in the log.
+    };
+
+    /// @brief How records are stored in the log file.
+    enum class Format
+    {
+        Text,  /// Human-readable lines.
+        Binary /// Self-describing binary records; render with decode().
+    };
+
+    /// @brief Type tag of a LOG_BINARY argument.
+    enum class Arg_type : uint8_t
+    {
+        Bool, Char, I8, U8, I16, U16, I32, U32, I64, U64, F32, F64, String, Pointer,
+        Raw /// Any other trivially copyable value, rendered as hex bytes.
+    };
+
+    /// @brief When the log file is closed and a new one started.
+    ///        Old files are renamed to filename.1 (newest) ... filename.<keep>, older ones are deleted.
+    struct Rotation
+    {
+        size_t max_size = 0;                   /// Bytes; 0 = unlimited. Checked per batch, so a file may overshoot by one batch.
+        std::chrono::seconds max_age{0};       /// 0 = unlimited.
+        size_t keep = 5;                       /// Number of old files kept. With 0 the file is truncated in place
+                                               /// on rotation, and what it held is lost.
+        bool mapped = false;                   /// Preallocate each file as a segment of max_size bytes (or LOGGER_SEGMENT_SIZE)
+                                               /// and write to it through mmap instead of write() calls.
+                                               /// A full segment is rotated, and trimmed to its used size when closed.
+    };
+
+    /// @brief Registered LOG_BINARY call site.
+    struct Format_info
+    {
+        std::string format;
+        std::string file;
+        uint32_t line;
+        std::vector<Arg_type> arg_types;
+        Log_level level = Log_level::Info;
+        std::string category; /// Name of the category when the format was registered.
+    };
+
+    /// @brief One LOG() line. Writes the level and category prefix,
+    ///        and flushes the line when destroyed at the end of the statement.
+    class Line
+    {
+        private:
+        std::ostream& stream;
+
+        public:
+        Line(Log_level level, uint8_t category, size_t n_suppressed = 0);
+        ~Line();
+
+        template<typename T>
+        inline Line& operator<<(const T& message)
+        {
+            stream << message;
+            return *this;
+        }
+    };
+
     static Logger& get();
 
-    void enable(const std::string& filename);
+    /// @brief Writes every line to the file on the caller's thread.
+    void enable(const std::string& filename, Format format = Format::Text);
+
+    /// @brief Pushes lines into per-thread lock-free buffers instead; a background
+    ///        thread collects them and writes them to the file in large batches.
+    /// @param buffer_size Size of each thread's buffer in bytes.
+    void enable_async(const std::string& filename, 
+                      Overflow_policy policy = Overflow_policy::Block, 
+                      size_t buffer_size = LOGGER_RING_SIZE,
+                      Format format = Format::Text);
+    /// @brief Stops logging, draining the async buffers first.
+    ///        Records logged by other threads while this runs may be lost.
     void disable();
 
+    /// @brief Rotation used by the following enable() calls; the file being written keeps its own.
+    void set_rotation(const Rotation& rotation);
+
+    /// @brief Keeps the last n_records lines in memory, independent of the log file.
+    ///        SIGSEGV, SIGBUS, SIGILL, SIGFPE and SIGABRT write them to dump_filename
+    ///        before the previous handler runs. Longer lines are cut to LOGGER_CRASH_RECORD_SIZE.
+    /// @warning Call once, at startup.
+    void enable_crash_ring(const std::string& dump_filename, size_t n_records = LOGGER_CRASH_RECORDS);
+    /// @brief Writes the crash ring to its dump file now, e.g. from a terminate handler. Async-signal-safe.
+    static void dump_crash_ring();
+
+    /// @brief Appends to the current line of the calling thread.
+    ///        Lines are written out on flush().
     template<typename T>
     Logger& operator<<(const T& message) {
-        if (logfile.has_value()) {
-            logfile.value() << message;
+        if (fd >= 0) {
+            line_stream() << message;
         }
         return *this;
     }
 
+    /// @brief Ends the calling thread's current line and writes it out.
     void flush();
 
+    /// @return Whether a line of this level and category would be written.
+    /// @param category Categories from LOGGER_MAX_CATEGORIES up share the last one.
+    inline bool enabled(Log_level level, uint8_t category) const
+    {
+        return level >= category_levels[clamp_category(category)].load(std::memory_order_relaxed) && fd >= 0;
+    }
+
+    /// @brief Sets the minimum level written for one category.
+    inline void set_level(uint8_t category, Log_level level)
+    {
+        category_levels[clamp_category(category)].store(level, std::memory_order_relaxed);
+    }
+    /// @brief Sets the minimum level written for every category.
+    void set_level(Log_level level);
+    inline Log_level level(uint8_t category) const 
+    { 
+        return category_levels[clamp_category(category)].load(std::memory_order_relaxed); 
+    }
+
+    /// @brief Name printed in the prefix of lines of a category.
+    /// @warning Set names before logging to the category starts.
+    void set_category_name(uint8_t category, const std::string& name);
+
+    /// @return Name of a level as printed in line prefixes.
+    static const char* level_name(Log_level level);
+
+    /// @return Number of records discarded by Drop or Count overflow policies.
+    size_t n_dropped() const;
+
+    /// @brief Backend of LOG_BINARY. The format is registered once per call site.
+    ///        In binary mode the arguments are only copied; in text mode the line is rendered right away.
+    template <typename... Args>
+    void write_binary(std::atomic<uint32_t>& site_id, Log_level level, uint8_t category, const char* format_str, 
+                      const char* file, uint32_t line, const Args&... args)
+    {
+        if (fd < 0) {
+            return;
+        }
+        uint32_t id = site_id.load(std::memory_order_acquire);
+        if (id == 0) {
+            id = register_format(format_str, file, line, {arg_type<Args>()...}, level, category);
+            site_id.store(id, std::memory_order_release);
+        }
+        Serialized& record = record_buffer();
+        record.clear();
+        append_record_header(record, Record_kind::Data, id, 0); // Payload size is patched below
+        (append_arg(record, args), ...);
+
+        uint32_t payload_size = record.size() - record_header_size;
+        std::memcpy(record.data() + record_header_size - sizeof(payload_size), &payload_size, sizeof(payload_size));
+        submit_record(record);
+    }
+
+    /// @brief Renders a binary log into text.
+    /// @return Whether the whole input was a valid binary log.
+    static bool decode(std::istream& binary, std::ostream& text);
+
     private:
+    enum class Record_kind : uint8_t
+    {
+        Definition = 1, /// Format string, argument types and call site of a format ID.
+        Data = 2,       /// Format ID and arguments.
+        Text = 3        /// Line written with operator<<.
+    };
+    static constexpr size_t record_header_size = sizeof(Record_kind) + 2 * sizeof(uint32_t);
+
+    template <typename Type>
+    static constexpr Arg_type arg_type()
+    {
+        using Decayed = std::decay_t<Type>;
+
+        if constexpr (std::is_same<Decayed, bool>::value) { return Arg_type::Bool; }
+        else if constexpr (std::is_same<Decayed, char>::value) { return Arg_type::Char; }
+        else if constexpr (std::is_integral<Decayed>::value) {
+            constexpr bool is_signed = std::is_signed<Decayed>::value;
+            if constexpr (sizeof(Decayed) == 1) { return is_signed ? Arg_type::I8 : Arg_type::U8; }
+            else if constexpr (sizeof(Decayed) == 2) { return is_signed ? Arg_type::I16 : Arg_type::U16; }
+            else if constexpr (sizeof(Decayed) == 4) { return is_signed ? Arg_type::I32 : Arg_type::U32; }
+            else { return is_signed ? Arg_type::I64 : Arg_type::U64; }
+        }
+        else if constexpr (std::is_same<Decayed, float>::value) { return Arg_type::F32; }
+        else if constexpr (std::is_floating_point<Decayed>::value) { return Arg_type::F64; }
+        else if constexpr (std::is_same<Decayed, const char*>::value || std::is_same<Decayed, char*>::value ||
+                           std::is_same<Decayed, std::string>::value || std::is_same<Decayed, std::string_view>::value) {
+            return Arg_type::String;
+        }
+        else if constexpr (std::is_pointer<Decayed>::value) { return Arg_type::Pointer; }
+        else {
+            static_assert(std::is_trivially_copyable<Decayed>::value, 
+                          "LOG_BINARY arguments must be strings or trivially copyable values.");
+            return Arg_type::Raw;
+        }
+    }
+
+    template <typename Type>
+    static void append_arg(Serialized& record, const Type& arg)
+    {
+        constexpr Arg_type type = arg_type<Type>();
+
+        if constexpr (type == Arg_type::String) {
+            std::string_view view(arg);
+            uint16_t size = static_cast<uint16_t>(std::min<size_t>(view.size(), UINT16_MAX));
+            serialize_append(record, size);
+            record.insert(record.end(), view.data(), view.data() + size);
+        }
+        else if constexpr (type == Arg_type::Pointer) {
+            serialize_append(record, reinterpret_cast<uint64_t>(arg));
+        }
+        else if constexpr (type == Arg_type::F64) {
+            serialize_append(record, static_cast<double>(arg));
+        }
+        else if constexpr (type == Arg_type::Raw) {
+            serialize_append(record, static_cast<uint16_t>(sizeof(Type)));
+            serialize_append(record, arg);
+        }
+        else {
+            serialize_append(record, arg);
+        }
+    }
+
+    static void append_record_header(std::vector<char>& out, Record_kind kind, uint32_t id, uint32_t payload_size);
+    /// @brief Reusable per-thread buffer for building binary records.
+    static Serialized& record_buffer();
+    uint32_t register_format(const char* format_str, const char* file, uint32_t line,
+                             std::vector<Arg_type> arg_types, Log_level level, uint8_t category);
+    /// @brief Writes a finished binary record, or renders it first in text mode.
+    void submit_record(const Serialized& record);
+    /// @brief Writes finished record or line, directly or through the async buffers.
+    void submit(const char* data, size_t size);
+    /// @brief Appends definition records of formats registered since the last call.
+    void append_definitions(std::vector<char>& out);
+
     Logger() = default;
     Logger(const Logger&) = delete;
     Logger& operator=(const Logger&) = delete;
     ~Logger();
 
-    std::optional<std::ofstream> logfile;
-};
\ No newline at end of file
+    struct Async_backend;
+
+    static inline uint8_t clamp_category(uint8_t category) 
+    { 
+        return category < LOGGER_MAX_CATEGORIES ? category : LOGGER_MAX_CATEGORIES - 1; 
+    }
+
+    /// @brief Stream that appends to the calling thread's line buffer.
+    static std::ostream& line_stream();
+    /// @brief Writes data to the log file, retrying on partial writes.
+    void write_out(const char* data, size_t size);
+    /// @brief Truncates filename and starts writing to it, closing the previous file.
+    void open_file();
+    void close_file();
+    /// @brief Resizes the file to size bytes and maps it. Falls back to write() on failure.
+    bool map_segment(size_t size);
+    /// @brief Unmaps the file and trims it to what was written.
+    void unmap_segment();
+    /// @brief Starts a new file before size more bytes are written, if the rotation says so.
+    void rotate_if_needed(size_t size);
+    void append_bytes(const char* data, size_t size);
+
+    std::atomic<int> fd = -1;
+    std::string filename;
+    Rotation rotation;      // Of the file being written; only touched under write_mutex
+    Rotation next_rotation; // Set by set_rotation(), used from the next enable() on
+    size_t file_size = 0;
+    std::chrono::steady_clock::time_point file_opened;
+    char* mapping = nullptr;
+    size_t mapping_size = 0;
+    std::atomic<Format> format = Format::Text;
+    std::mutex write_mutex;
+    size_t n_definitions_written = 0;
+    // Producers read async_current without locking and keep the backend alive with their own reference,
+    // so disable() never frees it under them. async is only touched under async_mutex.
+    std::shared_ptr<Async_backend> async;
+    std::atomic<Async_backend*> async_current = nullptr;
+    mutable std::mutex async_mutex;
+
+    std::atomic<Log_level> category_levels[LOGGER_MAX_CATEGORIES] = {};
+    std::string category_names[LOGGER_MAX_CATEGORIES];
+};
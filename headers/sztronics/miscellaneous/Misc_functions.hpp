@@ -1,9 +1,15 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <functional>
+#include <iterator>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <optional>
+#include <type_traits>
+#include <utility>
 #include <stdint.h>
 
 #include <sztronics/miscellaneous/Vector2.hpp>
@@ -21,18 +27,56 @@ inline bool pop_val(Iterable_type& container, const Key_type& key)
     return true;
 }
 
+/// @brief Position of the first element equal to key, scanned 16 bytes at a time.
+/// @return size if there is no such element.
+size_t find_equal(const uint8_t* data, size_t size, uint8_t key);
+size_t find_equal(const uint16_t* data, size_t size, uint16_t key);
+size_t find_equal(const uint32_t* data, size_t size, uint32_t key);
+size_t find_equal(const uint64_t* data, size_t size, uint64_t key);
+
+/// @brief Whether a container stores elements contiguously, behind data().
+template <typename Container_type, typename = void>
+struct Has_contiguous_data : std::false_type {};
+template <typename Container_type>
+struct Has_contiguous_data<Container_type, std::enable_if_t<std::is_same<
+    decltype(std::declval<const Container_type&>().data()), 
+    const typename Container_type::value_type*>::value>> : std::true_type {};
+
 /// @brief  Finds an element in array and returns its index.
+///         Contiguous containers of integers are searched with SIMD.
 /// @return index if element was found, none if it was not.
 template <typename Iterable_type, typename Key_type>
-inline std::optional<size_t> find_idx(const Iterable_type container, const Key_type& key) 
+inline std::optional<size_t> find_idx(const Iterable_type& container, const Key_type& key) 
 {
-    int index = 0;
-    for(auto iter = container.cbegin(); iter != container.cend(); iter++, index++) {
-        if(*iter == key) {
-            return {index};
+    using Value_type = typename Iterable_type::value_type;
+
+    if constexpr (Has_contiguous_data<Iterable_type>::value && 
+                  std::is_integral<Value_type>::value && !std::is_same<Value_type, bool>::value &&
+                  std::is_integral<Key_type>::value && !std::is_same<Key_type, bool>::value) {
+        Value_type value = static_cast<Value_type>(key);
+        if (static_cast<Key_type>(value) != key || (value < 0) != (key < 0)) { // Key not representable
+            return {};
         }
+        using Bits = std::make_unsigned_t<Value_type>;
+        using Lane = std::conditional_t<sizeof(Bits) == 1, uint8_t,
+                     std::conditional_t<sizeof(Bits) == 2, uint16_t,
+                     std::conditional_t<sizeof(Bits) == 4, uint32_t, uint64_t>>>;
+        size_t index = find_equal(reinterpret_cast<const Lane*>(container.data()), container.size(), 
+                                  static_cast<Lane>(static_cast<Bits>(value)));
+        if (index == container.size()) {
+            return {};
+        }
+        return {index};
+    }
+    else {
+        size_t index = 0;
+        for(auto iter = container.cbegin(); iter != container.cend(); iter++, index++) {
+            if(*iter == key) {
+                return {index};
+            }
+        }
+        return {};
     }
-    return {};
 }
 
 /// @brief attempts to erase the vector element at given index
@@ -45,26 +89,210 @@ inline void pop_idx(Iterable_type& container, const size_t& index) //Remove elem
     container.erase(iter);
 }
 
+/// @brief Removes the element at index by moving the last element into its place.
+///        O(1), but does not keep the order. Index wraps around like in pop_idx(); empty containers are left alone.
+template <typename Iterable_type>
+inline void swap_pop_idx(Iterable_type& container, size_t index)
+{
+    if (container.empty()) {
+        return;
+    }
+    size_t wrapped_idx = index % container.size();
+    if (wrapped_idx + 1 != container.size()) {
+        container[wrapped_idx] = std::move(container.back());
+    }
+    container.pop_back();
+}
+
+/// @brief Removes the first element equal to key by moving the last element into its place.
+/// @return Whether the element was found and popped.
+template <typename Iterable_type, typename Key_type>
+inline bool swap_pop_val(Iterable_type& container, const Key_type& key)
+{
+    std::optional<size_t> index = find_idx(container, key);
+    if (!index.has_value()) {
+        return false;
+    }
+    swap_pop_idx(container, index.value());
+    return true;
+}
+
+/// @brief Removes every element that satisfies predicate in a single pass, keeping the order.
+/// @return Number of elements removed.
+template <typename Iterable_type, typename Predicate_type>
+inline size_t pop_if(Iterable_type& container, Predicate_type predicate)
+{
+    auto new_end = std::remove_if(container.begin(), container.end(), predicate);
+    size_t n_removed = std::distance(new_end, container.end());
+    container.erase(new_end, container.end());
+    return n_removed;
+}
+
+/// @brief Removes every element equal to any of keys in a single pass, keeping the order.
+///        Each element is compared with every key; for many keys, use pop_if with a set.
+/// @return Number of elements removed.
+template <typename Iterable_type, typename Keys_type>
+inline size_t pop_vals(Iterable_type& container, const Keys_type& keys)
+{
+    using Value_type = typename Iterable_type::value_type;
+    return pop_if(container, [&keys](const Value_type& value) {
+        return std::find(keys.begin(), keys.end(), value) != keys.end();
+    });
+}
+
+/// @brief Removes elements at the given indices in a single pass, keeping the order.
+///        Indices may come in any order; duplicates and indices past the end are ignored.
+/// @return Number of elements removed.
+template <typename Iterable_type>
+inline size_t pop_idxs(Iterable_type& container, std::vector<size_t> indices)
+{
+    std::sort(indices.begin(), indices.end());
+    indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+
+    size_t write = indices.empty() ? container.size() : indices.front();
+    size_t next_removed = 0;
+    for (size_t read = write; read < container.size(); read++) {
+        if (next_removed < indices.size() && indices[next_removed] == read) {
+            next_removed++;
+            continue;
+        }
+        container[write++] = std::move(container[read]);
+    }
+    size_t n_removed = container.size() - std::min(write, container.size());
+    container.erase(container.begin() + std::min(write, container.size()), container.end());
+    return n_removed;
+}
+
+// Sorted vectors (flat sets) -- binary search instead of linear scans
+
+/// @return Index of key in a sorted container, none if it's not there.
+template <typename Iterable_type, typename Key_type, typename Compare_type = std::less<>>
+inline std::optional<size_t> sorted_find_idx(const Iterable_type& container, const Key_type& key, 
+                                             Compare_type compare = {})
+{
+    auto found = std::lower_bound(container.begin(), container.end(), key, compare);
+    if (found == container.end() || compare(key, *found)) {
+        return {};
+    }
+    return {static_cast<size_t>(std::distance(container.begin(), found))};
+}
+
+template <typename Iterable_type, typename Key_type, typename Compare_type = std::less<>>
+inline bool sorted_contains(const Iterable_type& container, const Key_type& key, Compare_type compare = {})
+{
+    return std::binary_search(container.begin(), container.end(), key, compare);
+}
+
+/// @brief Inserts value into a sorted container, unless an equal one is already there.
+/// @return Whether the value was inserted.
+template <typename Iterable_type, typename Value_type, typename Compare_type = std::less<>>
+inline bool sorted_insert(Iterable_type& container, Value_type&& value, Compare_type compare = {})
+{
+    auto position = std::lower_bound(container.begin(), container.end(), value, compare);
+    if (position != container.end() && !compare(value, *position)) {
+        return false;
+    }
+    container.insert(position, std::forward<Value_type>(value));
+    return true;
+}
+
+/// @brief Removes key from a sorted container.
+/// @return Whether the key was found and popped.
+template <typename Iterable_type, typename Key_type, typename Compare_type = std::less<>>
+inline bool sorted_pop_val(Iterable_type& container, const Key_type& key, Compare_type compare = {})
+{
+    std::optional<size_t> index = sorted_find_idx(container, key, compare);
+    if (!index.has_value()) {
+        return false;
+    }
+    container.erase(container.begin() + index.value());
+    return true;
+}
+
 /// @brief Split text into lines to fit inside given line width constraint.
 std::vector<std::string> wrap_text(const std::string& text, int32_t line_width);
 
+/// @brief Same lines as wrap_text, as views into text instead of copies.
+///        Does not allocate beyond growing lines, which is cleared first.
+void wrap_text_views(std::string_view text, int32_t line_width, std::vector<std::string_view>& lines);
+
 // character classes
 
+/// @brief Bit masks of char_class_table; combine them with |.
+struct Char_class
+{
+    static constexpr uint8_t Printable = 1 << 0; /// [ -~]
+    static constexpr uint8_t Word = 1 << 1;      /// [a-zA-Z0-9_]
+    static constexpr uint8_t Digit = 1 << 2;     /// [0-9]
+    static constexpr uint8_t Upper = 1 << 3;     /// [A-Z]
+    static constexpr uint8_t Lower = 1 << 4;     /// [a-z]
+    static constexpr uint8_t Space = 1 << 5;     /// [ \t\n\v\f\r]
+    static constexpr uint8_t Punct = 1 << 6;     /// Printable, but not a letter, digit or space
+    static constexpr uint8_t Hex = 1 << 7;       /// [0-9a-fA-F]
+    static constexpr uint8_t Alpha = Upper | Lower;
+};
+
+constexpr std::array<uint8_t, 256> make_char_class_table()
+{
+    std::array<uint8_t, 256> table = {};
+    for (uint32_t ch = 0; ch < 256; ch++) {
+        uint8_t classes = 0;
+        bool digit = '0' <= ch && ch <= '9';
+        bool upper = 'A' <= ch && ch <= 'Z';
+        bool lower = 'a' <= ch && ch <= 'z';
+        bool space = ch == ' ' || ('\t' <= ch && ch <= '\r');
+        bool printable = ' ' <= ch && ch <= '~';
+
+        if (printable) { classes |= Char_class::Printable; }
+        if (digit || upper || lower || ch == '_') { classes |= Char_class::Word; }
+        if (digit) { classes |= Char_class::Digit; }
+        if (upper) { classes |= Char_class::Upper; }
+        if (lower) { classes |= Char_class::Lower; }
+        if (space) { classes |= Char_class::Space; }
+        if (printable && !digit && !upper && !lower && !space) { classes |= Char_class::Punct; }
+        if (digit || ('a' <= ch && ch <= 'f') || ('A' <= ch && ch <= 'F')) { classes |= Char_class::Hex; }
+        table[ch] = classes;
+    }
+    return table;
+}
+
+/// @brief Char_class bits of every byte.
+inline constexpr std::array<uint8_t, 256> char_class_table = make_char_class_table();
+
+/// @return Whether a character belongs to any of the classes in mask.
+constexpr inline bool has_char_class(uint32_t ch, uint8_t mask)
+{
+    return ch < 256 && (char_class_table[ch] & mask) != 0;
+}
+
 /// @return Whether a character is a non-special symbol
 constexpr inline bool is_printable(uint32_t ch)
 {
-    return (31 < ch && ch < 127);
+    return has_char_class(ch, Char_class::Printable);
 }
 
 /// @return Whether a character is a legal name symbol ([a-zA-Z0-9_])
 constexpr inline bool is_wordch(uint32_t ch) 
 {
-    return ('0' < ch && ch < '9') || \
-           ('a' < ch && ch < 'z') || \
-           ('A' < ch && ch < 'Z') ||
-            ch == '_';
+    return has_char_class(ch, Char_class::Word);
 }
 
+/// @return Length of the run of characters at the start of text that belong to any class in mask.
+inline size_t char_class_prefix_length(std::string_view text, uint8_t mask)
+{
+    size_t length = 0;
+    while (length < text.size() && (char_class_table[static_cast<unsigned char>(text[length])] & mask) != 0) {
+        length++;
+    }
+    return length;
+}
+
+/// @return Length of the run of word characters at the start of text. Scans 16 bytes at a time.
+size_t word_prefix_length(std::string_view text);
+
+/// @return Position of the first character that is not printable, or text.size(). Scans 16 bytes at a time.
+size_t find_non_printable(std::string_view text);
+
 /// @brief Maps 2d array indices into 1d array index.
 constexpr inline int32_t to_1d(std::pair<int32_t, int32_t> indices, uint32_t width)
 {
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <utility>
+#include <new>
+#include <cstddef>
+
+#define OBJECT_POOL_SLAB_SIZE 256
+
+/// @brief Allocates objects of one type from fixed-size slabs.
+///        Addresses stay stable for the object's whole lifetime,
+///        freed slots are reused through an intrusive free list.
+/// @warning Not thread-safe. Every object must be destroyed before the pool.
+template <typename Type, size_t Slab_size = OBJECT_POOL_SLAB_SIZE>
+class Object_pool
+{
+    private:
+    union Slot
+    {
+        Slot* next;
+        alignas(Type) unsigned char storage[sizeof(Type)];
+    };
+
+    std::vector<std::unique_ptr<Slot[]>> slabs;
+    Slot* free_list = nullptr;
+    size_t n_alive = 0;
+
+    Object_pool(const Object_pool& other) = delete;
+    Object_pool& operator= (const Object_pool& other) = delete;
+
+    /// @brief Allocates a new slab and threads its slots onto the free list.
+    void grow()
+    {
+        slabs.emplace_back(new Slot[Slab_size]);
+        Slot* slab = slabs.back().get();
+
+        for (size_t i = 0; i < Slab_size - 1; i++) {
+            slab[i].next = &slab[i + 1];
+        }
+        slab[Slab_size - 1].next = free_list;
+        free_list = slab;
+    }
+
+    public:
+    Object_pool() = default;
+
+    /// @brief Constructs a new object in a free slot.
+    /// @return Pointer to the object; stays valid until destroy() is called on it.
+    template <typename... Args>
+    Type* create(Args&&... args)
+    {
+        if (free_list == nullptr) {
+            grow();
+        }
+        Slot* slot = free_list;
+        free_list = slot->next;
+
+        Type* object;
+        try {
+            object = new (slot->storage) Type(std::forward<Args>(args)...);
+        }
+        catch (...) { // Return the slot if constructor fails
+            slot->next = free_list;
+            free_list = slot;
+            throw;
+        }
+        n_alive++;
+        return object;
+    }
+
+    /// @brief Destroys an object created by this pool and makes its slot reusable.
+    void destroy(Type* object)
+    {
+        if (object == nullptr) {
+            return;
+        }
+        object->~Type();
+
+        Slot* slot = reinterpret_cast<Slot*>(object);
+        slot->next = free_list;
+        free_list = slot;
+        n_alive--;
+    }
+
+    /// @return Number of objects currently alive.
+    inline size_t size() const { return n_alive; }
+    /// @return Number of slots allocated, including free ones.
+    inline size_t capacity() const { return slabs.size() * Slab_size; }
+};
+
+/// @brief Deleter for std::unique_ptr that returns the object to its Object_pool.
+template <typename Type>
+struct Pool_deleter
+{
+    Object_pool<Type>* pool = nullptr;
+
+    inline void operator()(Type* object) const { pool->destroy(object); }
+};
+
+/// @brief Owning pointer to an object allocated from an Object_pool.
+template <typename Type>
+using Pooled_ptr = std::unique_ptr<Type, Pool_deleter<Type>>;
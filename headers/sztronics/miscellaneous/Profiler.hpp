@@ -0,0 +1,119 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#define PROFILER_RING_SIZE 16384
+#define PROFILER_HISTOGRAM_BUCKETS 64
+
+#define PROFILER_CONCAT_(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_(a, b)
+
+/// @brief Measures the rest of the enclosing scope as a zone. Name must be a string literal.
+///        Costs one relaxed load while the profiler is disabled;
+///        define PROFILER_DISABLED to remove zones at compile time.
+#ifndef PROFILER_DISABLED
+#define PROFILE_ZONE(name) \
+    static Profile_zone_info PROFILER_CONCAT(sz_profile_info_, __LINE__)(name, __FILE__, __LINE__); \
+    Profile_zone PROFILER_CONCAT(sz_profile_zone_, __LINE__)(PROFILER_CONCAT(sz_profile_info_, __LINE__))
+#else
+#define PROFILE_ZONE(name) do {} while (0)
+#endif
+
+/// @brief Call site of a PROFILE_ZONE and its counters, shared by all threads.
+struct Profile_zone_info
+{
+    const char* name;
+    const char* file;
+    uint32_t line;
+    uint32_t id;
+
+    std::atomic<uint64_t> n_calls = 0;
+    std::atomic<uint64_t> total_ns = 0;
+    std::atomic<uint64_t> max_ns = 0;
+    /// Bucket i counts durations in [2^(i-1), 2^i) nanoseconds; bucket 0 counts zero durations.
+    std::atomic<uint64_t> histogram[PROFILER_HISTOGRAM_BUCKETS] = {};
+
+    /// @brief Registers the zone with the Profiler.
+    Profile_zone_info(const char* name, const char* file, uint32_t line);
+
+    Profile_zone_info(const Profile_zone_info& other) = delete;
+    Profile_zone_info& operator= (const Profile_zone_info& other) = delete;
+};
+
+/// @brief Collects PROFILE_ZONE measurements.
+///        Counters and histograms are kept per zone; with tracing on, each zone
+///        also pushes an event into a lock-free buffer of its thread.
+class Profiler
+{
+    public:
+    struct Zone_stats
+    {
+        std::string name;
+        std::string file;
+        uint32_t line;
+        uint64_t n_calls;
+        uint64_t total_ns;
+        uint64_t max_ns;
+        std::vector<uint64_t> histogram;
+    };
+
+    /// @param tracing Also record individual events for export_chrome_trace().
+    static void enable(bool tracing = true);
+    static void disable();
+    static inline bool is_enabled() { return active.load(std::memory_order_relaxed); }
+
+    /// @return Steady clock time in nanoseconds.
+    static inline uint64_t now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                 std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /// @brief Adds one measurement of a zone; called by Profile_zone.
+    static void record(Profile_zone_info& zone, uint64_t start_ns, uint64_t end_ns);
+
+    /// @return Counters of every zone that was entered at least once.
+    static std::vector<Zone_stats> stats();
+    /// @brief Zeroes the counters and discards recorded events.
+    static void reset();
+
+    /// @brief Moves events out of the per-thread buffers. Call periodically
+    ///        while tracing, so that the buffers don't overflow.
+    /// @return Number of events collected so far.
+    static size_t collect();
+    /// @brief Collects and writes every event as Chrome trace-event JSON (chrome://tracing, Perfetto).
+    static bool export_chrome_trace(const std::string& filename);
+    /// @return Number of events lost because a thread's buffer was full.
+    static size_t n_dropped();
+
+    private:
+    static std::atomic<bool> active;
+    static std::atomic<bool> tracing;
+};
+
+/// @brief RAII measurement of one zone, created by PROFILE_ZONE.
+class Profile_zone
+{
+    private:
+    Profile_zone_info* zone;  // nullptr if the profiler was disabled on entry
+    uint64_t start_ns;
+
+    Profile_zone(const Profile_zone& other) = delete;
+    Profile_zone& operator= (const Profile_zone& other) = delete;
+
+    public:
+    inline explicit Profile_zone(Profile_zone_info& zone_info) :
+        zone(Profiler::is_enabled() ? &zone_info : nullptr),
+        start_ns(zone ? Profiler::now() : 0) {}
+
+    inline ~Profile_zone()
+    {
+        if (zone) {
+            Profiler::record(*zone, start_ns, Profiler::now());
+        }
+    }
+};
@@ -21,6 +21,19 @@ Serialized serialize(const Type& object)
     return serialized;
 }
 
+/// @brief Appends raw bytes of a fixed-size struct to a byte vector.
+///        Unlike serialize(), reuses out's capacity instead of allocating a new vector.
+template <typename Type>
+inline void serialize_append(Serialized& out, const Type& object)
+{
+    static_assert(std::is_trivially_copyable<Type>::value, \
+                  "serialize_append() only works with trivially copyable values.");
+
+    size_t offset = out.size();
+    out.resize(offset + sizeof(Type));
+    std::memcpy(out.data() + offset, &object, sizeof(Type));
+}
+
 /// @brief Serializes a string.
 template <>
 inline Serialized serialize(const std::string& str) {
@@ -62,6 +75,10 @@ Serialized serialize(const std::unordered_map<Keytype, Valtype>& map)
     return serialized;
 }
 
+/// @brief Always false; lets static_assert fail only when a branch is instantiated.
+template <typename Type>
+struct Serialization_unsupported : std::false_type {};
+
 template <typename Type>
 struct Serializable_vector_traits : std::false_type {};
 
@@ -143,6 +160,6 @@ Type deserialize(const Serialized& serialized)
         return map;
     }
     else { // Unsupported __________________________________________________________________
-        static_assert(false, "deserialize() only works with trivially copyable values or containers (umaps, vectors) of them.");
+        static_assert(Serialization_unsupported<Type>::value, "deserialize() only works with trivially copyable values or containers (umaps, vectors) of them.");
     }
 }
\ No newline at end of file
@@ -0,0 +1,344 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <queue>
+#include <optional>
+#include <utility>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <cstdlib>
+#include <stdint.h>
+#include <math.h>
+
+#include <sztronics/miscellaneous/Vector2.hpp>
+
+/// @brief Uniform hash grid over 2D points, used as a broad-phase proximity index.
+///        Points are identified by 32-bit IDs (e.g. Unique::get_uid()).
+///        Only non-empty cells are stored, so the world does not need to be bounded.
+template <typename T>
+class Spatial_hash
+{
+    private:
+    struct Item
+    {
+        uint32_t id;
+        Vector2<T> position;
+    };
+    /// @brief Where an item is stored: cell key and index inside that cell.
+    struct Location
+    {
+        uint64_t cell;
+        uint32_t slot;
+    };
+
+    double cell_size;
+    std::unordered_map<uint64_t, std::vector<Item>> cells;
+    std::unordered_map<uint32_t, Location> locations;
+
+    // Bounding box of all cells occupied since the last clear(), used to stop nearest() searches.
+    Vector2i min_cell = {std::numeric_limits<int32_t>::max(), std::numeric_limits<int32_t>::max()};
+    Vector2i max_cell = {std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::min()};
+
+    inline Vector2i cell_of(Vector2<T> position) const
+    {
+        return { static_cast<int32_t>(floor(static_cast<double>(position.x) / cell_size)),
+                 static_cast<int32_t>(floor(static_cast<double>(position.y) / cell_size)) };
+    }
+
+    static inline uint64_t key_of(Vector2i cell)
+    {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(cell.x)) << 32) | static_cast<uint32_t>(cell.y);
+    }
+
+    static inline double dist_sq(Vector2<T> a, Vector2<T> b)
+    {
+        double dx = static_cast<double>(a.x) - static_cast<double>(b.x);
+        double dy = static_cast<double>(a.y) - static_cast<double>(b.y);
+        return dx*dx + dy*dy;
+    }
+
+    inline const std::vector<Item>* find_cell(Vector2i cell) const
+    {
+        auto found = cells.find(key_of(cell));
+        return found == cells.end() ? nullptr : &found->second;
+    }
+
+    void place(uint32_t id, Vector2<T> position)
+    {
+        Vector2i cell = cell_of(position);
+        uint64_t key = key_of(cell);
+        std::vector<Item>& items = cells[key];
+
+        locations[id] = {key, static_cast<uint32_t>(items.size())};
+        items.push_back({id, position});
+
+        min_cell = {std::min(min_cell.x, cell.x), std::min(min_cell.y, cell.y)};
+        max_cell = {std::max(max_cell.x, cell.x), std::max(max_cell.y, cell.y)};
+    }
+
+    /// @brief Swap-and-pop removal of an item from its cell.
+    void unplace(Location location)
+    {
+        auto cell_iter = cells.find(location.cell);
+        std::vector<Item>& items = cell_iter->second;
+
+        if (location.slot != items.size() - 1) {
+            items[location.slot] = items.back();
+            locations[items[location.slot].id].slot = location.slot;
+        }
+        items.pop_back();
+        if (items.empty()) {
+            cells.erase(cell_iter);
+        }
+    }
+
+    /// @brief Calls visitor for each stored cell overlapping [lower_cell, upper_cell].
+    ///        Iterates over stored cells instead when the range is larger than their count.
+    template <typename Visitor>
+    void visit_cells(Vector2i lower_cell, Vector2i upper_cell, Visitor visitor) const
+    {
+        double n_range = (static_cast<double>(upper_cell.x) - lower_cell.x + 1) * 
+                         (static_cast<double>(upper_cell.y) - lower_cell.y + 1);
+
+        if (n_range > static_cast<double>(cells.size())) {
+            for (const auto& cell : cells) {
+                Vector2i coords = { static_cast<int32_t>(cell.first >> 32), 
+                                    static_cast<int32_t>(cell.first & 0xffffffff) };
+                if (coords >= lower_cell && coords <= upper_cell) {
+                    visitor(cell.second);
+                }
+            }
+            return;
+        }
+        for (int64_t x = lower_cell.x; x <= upper_cell.x; x++) {
+            for (int64_t y = lower_cell.y; y <= upper_cell.y; y++) {
+                const std::vector<Item>* items = find_cell({static_cast<int32_t>(x), static_cast<int32_t>(y)});
+                if (items != nullptr) {
+                    visitor(*items);
+                }
+            }
+        }
+    }
+
+    public:
+    /// @param cell_size Side of a grid cell. Works best when close to the typical query radius.
+    Spatial_hash(T cell_size) : cell_size(static_cast<double>(cell_size))
+    {
+        if (!(this->cell_size > 0.0)) {
+            throw std::invalid_argument("Spatial_hash(): cell size must be positive");
+        }
+    }
+
+    inline size_t size() const { return locations.size(); }
+    inline bool contains(uint32_t id) const { return locations.count(id) != 0; }
+
+    inline void clear() 
+    { 
+        cells.clear(); 
+        locations.clear(); 
+        min_cell = {std::numeric_limits<int32_t>::max(), std::numeric_limits<int32_t>::max()};
+        max_cell = {std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::min()};
+    }
+
+    /// @return Position of the point or nothing if it is not in the index.
+    std::optional<Vector2<T>> position_of(uint32_t id) const
+    {
+        auto found = locations.find(id);
+        if (found == locations.end()) {
+            return {};
+        }
+        return cells.at(found->second.cell)[found->second.slot].position;
+    }
+
+    /// @brief Adds a point, or moves it if the ID is already present.
+    void insert(uint32_t id, Vector2<T> position)
+    {
+        if (!move(id, position)) {
+            place(id, position);
+        }
+    }
+
+    /// @brief Updates the position of a point. Costs a single store if it stays in the same cell.
+    /// @return Whether the point was present.
+    bool move(uint32_t id, Vector2<T> position)
+    {
+        auto found = locations.find(id);
+        if (found == locations.end()) {
+            return false;
+        }
+        Location location = found->second;
+
+        if (key_of(cell_of(position)) == location.cell) {
+            cells[location.cell][location.slot].position = position;
+            return true;
+        }
+        unplace(location);
+        place(id, position);
+        return true;
+    }
+
+    /// @return Whether the point was present.
+    bool erase(uint32_t id)
+    {
+        auto found = locations.find(id);
+        if (found == locations.end()) {
+            return false;
+        }
+        Location location = found->second;
+        locations.erase(found);
+        unplace(location);
+        return true;
+    }
+
+    /// @brief Appends IDs of points within radius of center (inclusive) to out.
+    void query_radius(Vector2<T> center, double radius, std::vector<uint32_t>& out) const
+    {
+        double radius_sq = radius * radius;
+        Vector2i lower_cell = cell_of(Vector2<T>(static_cast<T>(center.x - radius), static_cast<T>(center.y - radius)));
+        Vector2i upper_cell = cell_of(Vector2<T>(static_cast<T>(center.x + radius), static_cast<T>(center.y + radius)));
+
+        visit_cells(lower_cell, upper_cell, [&](const std::vector<Item>& items) {
+            for (const Item& item : items) {
+                if (dist_sq(item.position, center) <= radius_sq) {
+                    out.push_back(item.id);
+                }
+            }
+        });
+    }
+
+    /// @brief Appends IDs of points inside the rectangle to out.
+    ///        Uses Vector2 bounds semantics: position >= lower && position < upper.
+    void query_rect(Vector2<T> lower, Vector2<T> upper, std::vector<uint32_t>& out) const
+    {
+        visit_cells(cell_of(lower), cell_of(upper), [&](const std::vector<Item>& items) {
+            for (const Item& item : items) {
+                if (item.position >= lower && item.position < upper) {
+                    out.push_back(item.id);
+                }
+            }
+        });
+    }
+
+    /// @brief Appends IDs of up to k points closest to center to out, nearest first.
+    void nearest(Vector2<T> center, size_t k, std::vector<uint32_t>& out) const
+    {
+        if (k == 0 || locations.empty()) {
+            return;
+        }
+        // Max-heap of the best candidates found so far
+        std::priority_queue<std::pair<double, uint32_t>> best;
+        Vector2i center_cell = cell_of(center);
+
+        int64_t max_ring = std::max({ static_cast<int64_t>(center_cell.x) - min_cell.x,
+                                      static_cast<int64_t>(max_cell.x) - center_cell.x,
+                                      static_cast<int64_t>(center_cell.y) - min_cell.y,
+                                      static_cast<int64_t>(max_cell.y) - center_cell.y });
+
+        size_t n_considered = 0;
+        size_t n_probes = 0;
+        auto consider = [&](const std::vector<Item>* items) {
+            if (items == nullptr) {
+                return;
+            }
+            n_considered += items->size();
+            for (const Item& item : *items) {
+                double dist = dist_sq(item.position, center);
+                if (best.size() < k) {
+                    best.push({dist, item.id});
+                }
+                else if (dist < best.top().first) {
+                    best.pop();
+                    best.push({dist, item.id});
+                }
+            }
+        };
+        auto probe = [&](int64_t x, int64_t y) {
+            n_probes++;
+            consider(find_cell({static_cast<int32_t>(x), static_cast<int32_t>(y)}));
+        };
+        for (int64_t ring = 0; ring <= max_ring; ring++) {
+            if (ring == 0) {
+                probe(center_cell.x, center_cell.y);
+            }
+            else { // Walk the ring's perimeter
+                for (int64_t offset = -ring; offset <= ring; offset++) {
+                    probe(center_cell.x + offset, center_cell.y - ring);
+                    probe(center_cell.x + offset, center_cell.y + ring);
+                }
+                for (int64_t offset = -ring + 1; offset <= ring - 1; offset++) {
+                    probe(center_cell.x - ring, center_cell.y + offset);
+                    probe(center_cell.x + ring, center_cell.y + offset);
+                }
+            }
+            if (n_considered == locations.size()) {
+                break;
+            }
+            // Anything in further rings is at least ring * cell_size away
+            double reach = static_cast<double>(ring) * cell_size;
+            if (best.size() == k && best.top().first <= reach * reach) {
+                break;
+            }
+            // Sparse points: visiting the remaining cells directly is cheaper than walking empty rings
+            if (n_probes > cells.size()) {
+                for (const auto& cell : cells) {
+                    int64_t dx = static_cast<int64_t>(static_cast<int32_t>(cell.first >> 32)) - center_cell.x;
+                    int64_t dy = static_cast<int64_t>(static_cast<int32_t>(cell.first & 0xffffffff)) - center_cell.y;
+                    if (std::max(std::abs(dx), std::abs(dy)) > ring) {
+                        consider(&cell.second);
+                    }
+                }
+                break;
+            }
+        }
+        size_t first = out.size();
+        out.resize(first + best.size());
+        for (size_t i = out.size(); i > first; i--) {
+            out[i - 1] = best.top().second;
+            best.pop();
+        }
+    }
+
+    /// @brief Calls callback(id_a, id_b) once for every pair of points within radius of each other.
+    ///        Costs about O(n) when radius does not exceed cell size and density is bounded.
+    template <typename Callback>
+    void for_each_pair(double radius, Callback callback) const
+    {
+        double radius_sq = radius * radius;
+        int32_t reach = static_cast<int32_t>(ceil(radius / cell_size));
+
+        for (const auto& cell : cells) {
+            const std::vector<Item>& items = cell.second;
+            Vector2i coords = { static_cast<int32_t>(cell.first >> 32), 
+                                static_cast<int32_t>(cell.first & 0xffffffff) };
+            // Pairs inside the cell
+            for (size_t i = 0; i < items.size(); i++) {
+                for (size_t j = i + 1; j < items.size(); j++) {
+                    if (dist_sq(items[i].position, items[j].position) <= radius_sq) {
+                        callback(items[i].id, items[j].id);
+                    }
+                }
+            }
+            // Pairs with neighbouring cells, each cell pair visited from one side only
+            for (int32_t dx = -reach; dx <= reach; dx++) {
+                for (int32_t dy = -reach; dy <= reach; dy++) {
+                    if (dx < 0 || (dx == 0 && dy <= 0)) {
+                        continue;
+                    }
+                    const std::vector<Item>* others = find_cell({coords.x + dx, coords.y + dy});
+                    if (others == nullptr) {
+                        continue;
+                    }
+                    for (const Item& item : items) {
+                        for (const Item& other : *others) {
+                            if (dist_sq(item.position, other.position) <= radius_sq) {
+                                callback(item.id, other.id);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+};
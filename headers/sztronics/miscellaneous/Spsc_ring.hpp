@@ -0,0 +1,112 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <utility>
+#include <cstring>
+#include <type_traits>
+
+/// @brief Lock-free bounded queue for exactly one producer thread and one consumer thread.
+///        Multi-element pushes are all-or-nothing, so a consumer never sees half a record.
+template <typename Type>
+class Spsc_ring
+{
+    static_assert(std::is_trivially_copyable<Type>::value, "Spsc_ring only works with trivially copyable values.");
+
+    private:
+    std::unique_ptr<Type[]> buffer;
+    size_t capacity_mask;
+
+    // Producer and consumer positions grow forever and are masked on access.
+    // Each side caches the other's position to avoid touching its cache line on every call.
+    alignas(64) std::atomic<size_t> head = 0;   // Written by consumer
+    size_t cached_tail = 0;
+    alignas(64) std::atomic<size_t> tail = 0;   // Written by producer
+    size_t cached_head = 0;
+
+    Spsc_ring(const Spsc_ring& other) = delete;
+    Spsc_ring& operator= (const Spsc_ring& other) = delete;
+
+    public:
+    /// @param min_capacity Rounded up to a power of two.
+    explicit Spsc_ring(size_t min_capacity)
+    {
+        size_t capacity = 1;
+        while (capacity < min_capacity) {
+            capacity <<= 1;
+        }
+        buffer.reset(new Type[capacity]);
+        capacity_mask = capacity - 1;
+    }
+
+    inline size_t capacity() const { return capacity_mask + 1; }
+
+    /// @return Number of elements available to the consumer (approximate from other threads).
+    inline size_t size() const { return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire); }
+    inline bool empty() const { return size() == 0; }
+
+    // Producer side ____________________________________________________________________________
+
+    /// @brief Appends n elements, or nothing if they don't all fit.
+    bool try_push(const Type* items, size_t n)
+    {
+        size_t cur_tail = tail.load(std::memory_order_relaxed);
+        if (cur_tail + n - cached_head > capacity()) {
+            cached_head = head.load(std::memory_order_acquire);
+            if (cur_tail + n - cached_head > capacity()) {
+                return false;
+            }
+        }
+        size_t start = cur_tail & capacity_mask;
+        size_t first_part = std::min(n, capacity() - start);
+        std::memcpy(&buffer[start], items, first_part * sizeof(Type));
+        std::memcpy(&buffer[0], items + first_part, (n - first_part) * sizeof(Type));
+
+        tail.store(cur_tail + n, std::memory_order_release);
+        return true;
+    }
+
+    inline bool try_push(const Type& item) { return try_push(&item, 1); }
+
+    // Consumer side ____________________________________________________________________________
+
+    /// @brief Contiguous run of readable elements at the front, without copying.
+    ///        May be shorter than size() when data wraps around; call consume() and repeat.
+    std::pair<const Type*, size_t> front_span()
+    {
+        size_t cur_head = head.load(std::memory_order_relaxed);
+        if (cur_head == cached_tail) {
+            cached_tail = tail.load(std::memory_order_acquire);
+        }
+        size_t available = cached_tail - cur_head;
+        size_t start = cur_head & capacity_mask;
+        return {&buffer[start], std::min(available, capacity() - start)};
+    }
+
+    /// @brief Releases n elements obtained from front_span() back to the producer.
+    inline void consume(size_t n)
+    {
+        head.store(head.load(std::memory_order_relaxed) + n, std::memory_order_release);
+    }
+
+    /// @brief Moves up to max_items elements into out.
+    /// @return Number of elements popped.
+    size_t pop(Type* out, size_t max_items)
+    {
+        size_t popped = 0;
+        while (popped < max_items) {
+            std::pair<const Type*, size_t> span = front_span();
+            size_t n = std::min(span.second, max_items - popped);
+            if (n == 0) {
+                break;
+            }
+            std::memcpy(out + popped, span.first, n * sizeof(Type));
+            consume(n);
+            popped += n;
+        }
+        return popped;
+    }
+
+    inline bool try_pop(Type& out) { return pop(&out, 1) == 1; }
+};
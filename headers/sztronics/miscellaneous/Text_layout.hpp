@@ -0,0 +1,101 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include <stdint.h>
+
+/// @brief Decodes the UTF-8 sequence at pos and moves pos past it.
+///        Invalid or truncated sequences decode as U+FFFD, one byte at a time.
+uint32_t utf8_decode(std::string_view text, size_t& pos);
+
+/// @return Terminal columns taken by a codepoint: 0 for combining marks and control characters,
+///         2 for wide East Asian characters and emoji, 1 otherwise.
+int codepoint_width(uint32_t codepoint);
+
+/// @return Terminal columns taken by UTF-8 text.
+size_t display_width(std::string_view text);
+
+/// @brief Splits UTF-8 text into lines no wider than line_width columns.
+///        Breaks at spaces like wrap_text; words wider than a line are split between codepoints.
+/// @param line_width Set to 0 or negative to only split at newlines.
+/// @param lines Cleared, then filled with views into text.
+void wrap_text_utf8(std::string_view text, int32_t line_width, std::vector<std::string_view>& lines);
+
+/// @brief Wrapped text that is edited paragraph by paragraph (a paragraph ends with '\n').
+///        Each paragraph caches its own lines, so an edit rewraps only the paragraphs it replaces.
+///        Line lookups go through a Fenwick tree of line counts per paragraph.
+class Text_layout
+{
+    public:
+    /// @brief Line of a paragraph, in bytes from the paragraph start.
+    struct Line
+    {
+        size_t offset;
+        size_t length;
+    };
+
+    explicit Text_layout(int32_t line_width = 0);
+
+    /// @brief Rewraps every paragraph.
+    void set_width(int32_t line_width);
+    inline int32_t get_width() const { return line_width; }
+
+    /// @brief Replaces all text.
+    void set_text(std::string_view text);
+    /// @return All paragraphs joined with '\n'.
+    std::string text() const;
+
+    /// @brief Replaces count paragraphs starting at first with the paragraphs of text.
+    ///        Only the new paragraphs are wrapped. If the number of paragraphs changes,
+    ///        the line index is rebuilt in O(paragraphs) from the cached line counts.
+    void replace_paragraphs(size_t first, size_t count, std::string_view text);
+    inline void set_paragraph(size_t index, std::string_view text) { replace_paragraphs(index, 1, text); }
+    inline void insert_paragraph(size_t index, std::string_view text) { replace_paragraphs(index, 0, text); }
+    void erase_paragraphs(size_t first, size_t count = 1);
+
+    inline size_t n_paragraphs() const { return paragraphs.size(); }
+    inline const std::string& paragraph(size_t index) const { return paragraphs[index].text; }
+    inline const std::vector<Line>& paragraph_lines(size_t index) const { return paragraphs[index].lines; }
+
+    inline size_t n_lines() const { return line_index.total(); }
+    /// @return Wrapped line by its index in the whole text; empty past the last line.
+    std::string_view line(size_t index) const;
+    /// @return Paragraph of a line and the line's index within it; {n_paragraphs(), 0} past the last line.
+    std::pair<size_t, size_t> locate_line(size_t index) const;
+    /// @return Index of the first line of a paragraph.
+    inline size_t first_line_of(size_t paragraph) const { return line_index.prefix(paragraph); }
+
+    private:
+    /// @brief Prefix sums with O(log n) updates and searches.
+    class Fenwick_tree
+    {
+        private:
+        std::vector<size_t> tree = {0}; // 1-based
+
+        public:
+        /// @brief Builds the tree in O(n).
+        void assign(const std::vector<size_t>& values);
+        void add(size_t index, ptrdiff_t delta);
+        /// @return Sum of the first count values.
+        size_t prefix(size_t count) const;
+        inline size_t total() const { return prefix(tree.size() - 1); }
+        /// @return Index of the value that contains the k-th unit; k becomes the offset within it.
+        size_t find(size_t& k) const;
+    };
+
+    struct Paragraph
+    {
+        std::string text;
+        std::vector<Line> lines;
+    };
+
+    void wrap(Paragraph& paragraph) const;
+    void rebuild_index();
+
+    int32_t line_width;
+    std::vector<Paragraph> paragraphs;
+    Fenwick_tree line_index;
+};
@@ -2,37 +2,174 @@
 
 #include <chrono>
 #include <vector>
+#include <deque>
 #include <functional>
 #include <optional>
 #include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <stdint.h>
+
+#define TIMER_WHEEL_RESOLUTION_NS 1000000
+#define TIMER_WHEEL_LEVELS 4
+#define TIMER_WHEEL_SLOTS 256
 
 /// @brief Class that can schedule certain events or execute them periodically.
 class Timer
 {
+    public:
+    /// @brief All time values are kept as integer nanoseconds, so precision doesn't degrade with uptime.
+    using Duration = std::chrono::nanoseconds;
+    /// @brief Source of monotonic time, measured from an arbitrary fixed point.
+    using Clock = std::function<Duration(void)>;
+
+    /// @brief Reads std::chrono::steady_clock. Used by default.
+    static Duration steady_now();
+    /// @brief Reads CLOCK_MONOTONIC_RAW where available, which is not slewed by NTP
+    ///        and is served from the vDSO. Falls back to steady_now() elsewhere.
+    static Duration raw_now();
+
     private:
-    static float get_cur_time_s();
-    float prev_time, delta_time;
+    Clock clock;
+    Duration prev_time, delta_time;
 
     public:
-    Timer();
+    /// @param clock Time source; pass a custom one to drive the timer deterministically.
+    Timer(Clock clock = steady_now);
+    ~Timer();
+    /// @brief Moves every event to the new timer; handles from schedule() refer to it afterwards.
+    ///        Stops the executor of both timers, so start it again on the destination if needed.
+    Timer(Timer&& other);
+    Timer& operator=(Timer&& other);
+
+    /// @return Current time of the timer's clock.
+    inline Duration now() const { return clock(); }
 
     /// @brief Event executed with certain timing or periodicity.
     struct Timed_event
     {
         std::function<void(void)> event = {};
         std::optional<std::reference_wrapper<std::mutex>> mutex; /// The mutex to lock when triggering event.
-        float t_seconds = 0.0;
-        float countdown = 0.0;
+        Duration period = Duration::zero();
+        Duration countdown = Duration::zero();
         int n_repeat = -1;
 
         /// @brief Creates a Timed_event.
         /// @param event The function to call when event happens.
-        /// @param t_seconds Period between event calls in seconds.
+        /// @param period Period between event calls.
         /// @param n_repeat How many times to fire the event. Set to -1 to repeat it infinitely.
+        Timed_event(std::function<void(void)> event, Duration period, int n_repeat = -1);
+        /// @param t_seconds Period between event calls in seconds.
         Timed_event(std::function<void(void)> event, float t_seconds, int n_repeat = -1);
     };
 
+    /// @brief Identifies an event added with schedule().
+    struct Event_handle
+    {
+        uint32_t index = UINT32_MAX;
+        uint32_t generation = 0;
+    };
+
     void process();
     std::vector<Timed_event> events;
-    bool skip_stalled;
-};
\ No newline at end of file
+    /// Atomic, as executor workers read it while other threads may change it.
+    std::atomic<bool> skip_stalled;
+
+    /// @brief Adds an event to the timing wheel. Unlike events[], wheel events cost
+    ///        nothing on process() until they are due, and can be cancelled in O(1).
+    /// @return Handle that can be used to cancel the event.
+    Event_handle schedule(Timed_event event);
+
+    /// @brief Stops an event added with schedule() from firing again.
+    ///        Safe to call from inside the event itself.
+    /// @return Whether the event was still scheduled.
+    bool cancel(Event_handle handle);
+
+    /// @return Whether the event is still scheduled to fire.
+    bool is_scheduled(Event_handle handle) const;
+
+    /// @return Number of events in the timing wheel.
+    size_t n_scheduled() const;
+
+    /// @brief Starts firing wheel events on background threads instead of in process().
+    ///        A timer thread sleeps until the next deadline and hands due events to a pool
+    ///        of workers, so one slow event doesn't delay the others. Events sharing a
+    ///        Timed_event::mutex are still serialized by it, and a periodic event is never
+    ///        run by two workers at once. events[] is still serviced only by process().
+    /// @param n_workers Number of worker threads; 0 picks hardware concurrency.
+    void start_executor(unsigned n_workers = 0);
+
+    /// @brief Stops background threads after running events finish.
+    ///        Events that were due but not started go back to the wheel.
+    ///        May be called from an event on a worker: that worker then exits once the
+    ///        event returns, and is joined by the next start_executor() or stop_executor() call,
+    ///        or by the destructor.
+    void stop_executor();
+
+    /// @return Whether wheel events are fired by background threads.
+    bool executor_running() const;
+
+    private:
+    static constexpr uint32_t no_node = UINT32_MAX;
+
+    /// @brief Timed_event stored in the hierarchical timing wheel.
+    struct Wheel_node
+    {
+        Timed_event event;
+        Duration deadline;           // Exact time to fire at, relative to wheel_origin
+        uint64_t expires = 0;        // Tick to fire at
+        uint32_t prev = no_node;     // Neighbours in the slot list
+        uint32_t next = no_node;
+        uint32_t generation = 0;     // Incremented every time the node is freed
+        int8_t level = -1;           // -1 if not linked into any slot
+        uint8_t slot = 0;
+        bool in_use = false;
+        bool cancelled = false;      // Cancelled while waiting to be fired or being fired
+
+        Wheel_node(Timed_event event) : event(std::move(event)) {}
+    };
+
+    Duration wheel_origin;
+    Duration process_time = Duration::zero(); // Time of the current process() call, relative to wheel_origin
+    uint64_t cur_tick = 0;
+    size_t n_wheel_events = 0;
+    // Deque keeps node references valid while an event schedules new ones
+    std::deque<Wheel_node> nodes;
+    std::vector<uint32_t> free_nodes;
+    uint32_t wheel[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+    uint64_t occupied[TIMER_WHEEL_SLOTS / 64] = {}; // Non-empty slots of the lowest level
+    std::vector<Event_handle> due_scratch;
+
+    // Guards the wheel; event callbacks are always called without holding it
+    mutable std::mutex wheel_mutex;
+    std::condition_variable wheel_changed;   // Wakes the timer thread
+    std::condition_variable dispatch_ready;  // Wakes workers
+    std::deque<Event_handle> dispatch_queue;
+    std::thread timer_thread;
+    std::vector<std::thread> workers;
+    bool executor_active = false;
+    /// Incremented by every start_executor(), so threads of a stopped executor never serve a later one.
+    uint64_t executor_generation = 0;
+    /// Threads that stopped the executor from inside an event and couldn't join themselves.
+    std::vector<std::thread> stopped_threads;
+
+    static uint64_t ticks_until(Duration time);
+    void link(uint32_t index);
+    void unlink(uint32_t index);
+    void release(uint32_t index);
+    void cascade(int level);
+    uint64_t next_ground_tick(uint64_t limit) const;
+    void collect_due(uint64_t target_tick, std::vector<Event_handle>& due);
+    bool fire(Event_handle handle);
+    /// @brief Links an event that was taken off the wheel back into it, unless it was freed or cancelled.
+    void return_to_wheel(Event_handle handle);
+    /// @brief Joins stopped_threads, except the calling thread. Call without holding wheel_mutex.
+    void join_stopped_threads();
+    inline bool executor_current(uint64_t generation) const 
+    { 
+        return executor_active && executor_generation == generation; 
+    }
+    void run_timer_thread(uint64_t generation);
+    void run_worker(uint64_t generation);
+};
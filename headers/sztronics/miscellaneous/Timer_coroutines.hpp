@@ -0,0 +1,313 @@
+#pragma once
+
+// C++20 coroutine layer over Timer. The rest of the library builds as C++17,
+// so this header is only usable from translation units compiled as C++20.
+#if !defined(__cpp_impl_coroutine)
+#error "Timer_coroutines.hpp requires C++20 coroutine support"
+#endif
+
+#include <coroutine>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <exception>
+#include <algorithm>
+
+#include <sztronics/miscellaneous/Timer.hpp>
+
+#define COROUTINE_FRAME_GRANULARITY 64
+#define COROUTINE_FRAME_CLASSES 16
+/// Most frames a thread keeps per size class; further frames freed on it go to the global allocator.
+#define COROUTINE_FRAME_CACHE_SIZE 64
+
+/// @brief Recycles coroutine frames through per-thread free lists, one per size class.
+///        Frames larger than COROUTINE_FRAME_GRANULARITY * COROUTINE_FRAME_CLASSES
+///        go to the global allocator. Frames may be freed on any thread: each cache
+///        is capped, so threads that only free frames don't hoard them.
+class Coroutine_frame_pool
+{
+    private:
+    struct Cache
+    {
+        std::vector<void*> free_frames[COROUTINE_FRAME_CLASSES];
+
+        // Reserved up front, so freeing a frame never allocates
+        Cache()
+        {
+            for (std::vector<void*>& frames : free_frames) {
+                frames.reserve(COROUTINE_FRAME_CACHE_SIZE);
+            }
+        }
+
+        ~Cache()
+        {
+            destroyed() = true;
+            for (std::vector<void*>& frames : free_frames) {
+                for (void* frame : frames) {
+                    ::operator delete(frame);
+                }
+            }
+        }
+    };
+
+    /// @brief Set once the calling thread's cache is destroyed, so frames freed
+    ///        later during thread exit bypass it. Trivially destructible, so it outlives the cache.
+    static bool& destroyed()
+    {
+        thread_local bool cache_destroyed = false;
+        return cache_destroyed;
+    }
+
+    /// @return The calling thread's cache, or nullptr if it was already destroyed.
+    static Cache* cache()
+    {
+        if (destroyed()) {
+            return nullptr;
+        }
+        thread_local Cache thread_cache;
+        return &thread_cache;
+    }
+
+    static inline size_t size_class(size_t size)
+    {
+        return (size + COROUTINE_FRAME_GRANULARITY - 1) / COROUTINE_FRAME_GRANULARITY;
+    }
+
+    public:
+    static void* allocate(size_t size)
+    {
+        size_t frame_class = size_class(size);
+        Cache* thread_cache = frame_class <= COROUTINE_FRAME_CLASSES ? cache() : nullptr;
+        if (thread_cache == nullptr) {
+            return ::operator new(size);
+        }
+        std::vector<void*>& frames = thread_cache->free_frames[frame_class - 1];
+        if (frames.empty()) {
+            return ::operator new(frame_class * COROUTINE_FRAME_GRANULARITY);
+        }
+        void* frame = frames.back();
+        frames.pop_back();
+        return frame;
+    }
+
+    static void deallocate(void* frame, size_t size)
+    {
+        size_t frame_class = size_class(size);
+        Cache* thread_cache = frame_class <= COROUTINE_FRAME_CLASSES ? cache() : nullptr;
+        if (thread_cache == nullptr || thread_cache->free_frames[frame_class - 1].size() >= COROUTINE_FRAME_CACHE_SIZE) {
+            ::operator delete(frame);
+            return;
+        }
+        thread_cache->free_frames[frame_class - 1].push_back(frame);
+    }
+};
+
+/// @brief Fire-and-forget coroutine that starts immediately and frees itself when done.
+///        Its frame comes from Coroutine_frame_pool.
+struct Timer_task
+{
+    struct promise_type
+    {
+        Timer_task get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+
+        static void* operator new(size_t size) { return Coroutine_frame_pool::allocate(size); }
+        static void operator delete(void* frame, size_t size) { Coroutine_frame_pool::deallocate(frame, size); }
+    };
+};
+
+/// @brief Shared state of a delay that can be cancelled; see Timer_delay.
+struct Timer_wait_state
+{
+    std::mutex mutex;
+    std::coroutine_handle<> handle;
+    Timer* timer = nullptr;
+    Timer::Event_handle event;
+    bool done = false;
+    bool cancelled = false;
+
+    /// @brief Resumes the waiting coroutine unless someone already did.
+    void finish(bool by_cancel)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (done) {
+                return;
+            }
+            done = true;
+            cancelled = by_cancel;
+        }
+        if (by_cancel) {
+            timer->cancel(event);
+        }
+        handle.resume();
+    }
+};
+
+/// @brief Lets a Cancellation_source stop pending delays. A default-constructed token never cancels.
+class Cancellation_token
+{
+    private:
+    struct State
+    {
+        std::mutex mutex;
+        bool cancelled = false;
+        std::vector<std::weak_ptr<Timer_wait_state>> waiters;
+        size_t prune_at = 16;
+    };
+    std::shared_ptr<State> state;
+
+    Cancellation_token(std::shared_ptr<State> state) : state(std::move(state)) {}
+    friend class Cancellation_source;
+    friend class Timer_delay;
+
+    /// @brief Registers a delay to be cancelled.
+    /// @return false if the token is already cancelled.
+    bool add_waiter(const std::shared_ptr<Timer_wait_state>& waiter) const
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (state->cancelled) {
+            return false;
+        }
+        // Drop delays that finished long ago once in a while
+        if (state->waiters.size() >= state->prune_at) {
+            state->waiters.erase(std::remove_if(state->waiters.begin(), state->waiters.end(),
+                                 [](const std::weak_ptr<Timer_wait_state>& w) { return w.expired(); }),
+                                 state->waiters.end());
+            state->prune_at = std::max<size_t>(16, state->waiters.size() * 2);
+        }
+        state->waiters.push_back(waiter);
+        return true;
+    }
+
+    public:
+    Cancellation_token() = default;
+
+    inline bool can_cancel() const { return state != nullptr; }
+
+    bool is_cancelled() const
+    {
+        if (!state) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(state->mutex);
+        return state->cancelled;
+    }
+};
+
+/// @brief Issues Cancellation_tokens and cancels everything waiting on them.
+class Cancellation_source
+{
+    private:
+    std::shared_ptr<Cancellation_token::State> state = std::make_shared<Cancellation_token::State>();
+
+    public:
+    inline Cancellation_token token() const { return Cancellation_token(state); }
+
+    /// @brief Resumes every pending delay of issued tokens on this thread, with a "cancelled" result.
+    void cancel()
+    {
+        std::vector<std::weak_ptr<Timer_wait_state>> waiters;
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (state->cancelled) {
+                return;
+            }
+            state->cancelled = true;
+            waiters.swap(state->waiters);
+        }
+        for (std::weak_ptr<Timer_wait_state>& waiter : waiters) {
+            if (std::shared_ptr<Timer_wait_state> locked = waiter.lock()) {
+                locked->finish(true);
+            }
+        }
+    }
+};
+
+/// @brief Awaitable that resumes the coroutine once duration elapses on the timer.
+///        co_await yields true if the time elapsed, false if it was cancelled.
+///        The coroutine is resumed on whichever thread fires timer events
+///        (the caller of Timer::process() or an executor worker).
+/// @warning GCC 12 miscompiles `if (co_await after(...))`, with any temporary awaiter that has
+///          a destructor; the resumed coroutine crashes. Store the result first:
+///          `bool elapsed = co_await after(...); if (elapsed) ...`
+class Timer_delay
+{
+    private:
+    Timer& timer;
+    Timer::Duration duration;
+    Cancellation_token token;
+    std::shared_ptr<Timer_wait_state> state; // Only allocated for cancellable delays
+
+    public:
+    Timer_delay(Timer& timer, Timer::Duration duration, Cancellation_token token = {}) :
+        timer(timer), duration(duration), token(std::move(token)) {}
+
+    bool await_ready() const { return token.is_cancelled(); }
+
+    bool await_suspend(std::coroutine_handle<> handle)
+    {
+        if (!token.can_cancel()) { // Fast path: a coroutine handle fits into std::function without allocating
+            timer.schedule(Timer::Timed_event([handle]() { handle.resume(); }, duration, 1));
+            return true;
+        }
+        state = std::make_shared<Timer_wait_state>();
+        std::lock_guard<std::mutex> lock(state->mutex); // Hold off both resumers until armed
+        state->handle = handle;
+        state->timer = &timer;
+        if (!token.add_waiter(state)) {
+            state->done = true;
+            state->cancelled = true;
+            return false;
+        }
+        std::shared_ptr<Timer_wait_state> fired_state = state;
+        state->event = timer.schedule(Timer::Timed_event([fired_state]() { fired_state->finish(false); }, duration, 1));
+        return true;
+    }
+
+    bool await_resume() const
+    {
+        if (token.can_cancel() && (!state || state->cancelled)) {
+            return false;
+        }
+        return true;
+    }
+};
+
+/// @brief Periodic async generator: each next() completes one period after the previous tick.
+///        Ticks are anchored to the start time, so they don't drift; missed ticks complete at once.
+class Timer_ticker
+{
+    private:
+    Timer& timer;
+    Timer::Duration period;
+    Timer::Duration next_tick;
+    Cancellation_token token;
+
+    public:
+    Timer_ticker(Timer& timer, Timer::Duration period, Cancellation_token token = {}) :
+        timer(timer), period(period), next_tick(timer.now() + period), token(std::move(token)) {}
+
+    /// @brief Awaitable for the next tick; yields false once cancelled.
+    Timer_delay next()
+    {
+        Timer::Duration wait = std::max(next_tick - timer.now(), Timer::Duration::zero());
+        next_tick += period;
+        return Timer_delay(timer, wait, token);
+    }
+};
+
+/// @brief co_await after(timer, dt) suspends the coroutine for dt.
+inline Timer_delay after(Timer& timer, Timer::Duration duration, Cancellation_token token = {})
+{
+    return Timer_delay(timer, duration, std::move(token));
+}
+
+/// @brief Creates a ticker: while (co_await ticks.next()) { ... }
+inline Timer_ticker every(Timer& timer, Timer::Duration period, Cancellation_token token = {})
+{
+    return Timer_ticker(timer, period, std::move(token));
+}
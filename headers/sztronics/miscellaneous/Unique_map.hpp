@@ -1,6 +1,7 @@
 #pragma once
 
 #include <sztronics/miscellaneous/Unique.hpp>
+#include <sztronics/miscellaneous/Object_pool.hpp>
 
 #include <type_traits>
 #include <map>
@@ -120,6 +121,46 @@ class Unique_map<std::unique_ptr<Type>> : public Unique_map_base<std::unique_ptr
     virtual uint32_t get_uid(const std::unique_ptr<Type>& unique) override { return unique->get_uid(); }
 };
 
+/// @brief Owning map that allocates its elements from slabs tied to the map's lifetime.
+///        Use emplace_new() to construct elements in place.
+template<typename Type>
+class Unique_map<Pooled_ptr<Type>> : public Unique_map_base<Pooled_ptr<Type>> {
+    static_assert(std::is_base_of<Unique, Type>::value, "Unique_map contents or elements they refer to must have Unique as their base.");
+    using BaseType = Unique_map_base<Pooled_ptr<Type>>;
+
+    std::unique_ptr<Object_pool<Type>> pool = std::make_unique<Object_pool<Type>>();
+
+    virtual uint32_t get_uid(const Pooled_ptr<Type>& unique) override { return unique->get_uid(); }
+
+public:
+    Unique_map() = default;
+    // Elements move together with the pool they live in; the base's map is moved first,
+    // so on assignment the old elements are released while their pool is still alive
+    Unique_map(Unique_map&&) = default;
+    Unique_map& operator=(Unique_map&&) = default;
+    // Elements must be released while the pool is still alive
+    ~Unique_map() { BaseType::clear(); }
+
+    /// @brief Constructs a new element inside the map's pool.
+    /// @return Reference to the new element; its address is stable until it is erased.
+    template <typename... Args>
+    Type& emplace_new(Args&&... args) {
+        if (!pool) { // Moved from
+            pool = std::make_unique<Object_pool<Type>>();
+        }
+        Pooled_ptr<Type> element(pool->create(std::forward<Args>(args)...), Pool_deleter<Type>{pool.get()});
+        Type& ref = *element;
+        BaseType::emplace(std::move(element));
+        return ref;
+    }
+
+    /// @brief Swaps contents together with the pools that own them.
+    inline void swap(Unique_map<Pooled_ptr<Type>>& other) {
+        BaseType::swap(other);
+        pool.swap(other.pool);
+    }
+};
+
 template<typename Type>
 class Unique_map<std::shared_ptr<Type>> : public Unique_map_base<std::shared_ptr<Type>> {
     static_assert(std::is_base_of<Unique, Type>::value, "Unique_map contents or elements they refer to must have Unique as their base.");
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <type_traits>
+#include <algorithm>
+#include <math.h>
+
+#include <sztronics/miscellaneous/Vector2.hpp>
+
+// Batch kernels over separate x and y float arrays.
+// Implemented with SSE2, AVX2 or NEON when available, scalar code otherwise.
+// On x86-64, AVX2 kernels are picked at runtime if the CPU has AVX2 (SZTRONICS_SIMD_DISPATCH).
+
+void vector2_batch_add(float* xs, float* ys, const float* other_xs, const float* other_ys, size_t n);
+void vector2_batch_add(float* xs, float* ys, float dx, float dy, size_t n);
+void vector2_batch_scale(float* xs, float* ys, float fx, float fy, size_t n);
+void vector2_batch_dot(const float* xs, const float* ys, const float* other_xs, const float* other_ys, float* out, size_t n);
+void vector2_batch_len(const float* xs, const float* ys, float* out, size_t n);
+void vector2_batch_normalize(float* xs, float* ys, size_t n);
+void vector2_batch_clamp(float* xs, float* ys, Vector2f upper_bound, Vector2f lower_bound, size_t n);
+void vector2_batch_len_manh(const float* xs, const float* ys, float* out, size_t n);
+void vector2_batch_len_chess(const float* xs, const float* ys, float* out, size_t n);
+
+/// @brief Name of the instruction set used by vector2_batch_* kernels on this CPU.
+const char* vector2_batch_isa();
+
+/// @brief Structure-of-arrays container of 2D vectors.
+///        Stores x and y components in separate contiguous arrays so that
+///        whole-array operations can be vectorized. Float arrays use SIMD kernels,
+///        other types fall back to scalar loops with Vector2 semantics.
+template <typename T>
+class Vector2_array
+{
+    private:
+    std::vector<T> xs;
+    std::vector<T> ys;
+
+    static constexpr bool simd = std::is_same<T, float>::value;
+
+    public:
+    /// @brief Type returned by len(): float for float arrays, double otherwise (as in Vector2::len).
+    using Length = typename std::conditional<std::is_same<T, float>::value, float, double>::type;
+
+    Vector2_array() = default;
+    Vector2_array(size_t size, Vector2<T> value = {}) : xs(size, value.x), ys(size, value.y) {}
+    Vector2_array(const std::vector<Vector2<T>>& vectors)
+    {
+        reserve(vectors.size());
+        for (const Vector2<T>& vec : vectors) {
+            push_back(vec);
+        }
+    }
+
+    inline size_t size() const { return xs.size(); }
+    inline bool empty() const { return xs.empty(); }
+    inline void reserve(size_t capacity) { xs.reserve(capacity); ys.reserve(capacity); }
+    inline void resize(size_t size, Vector2<T> value = {}) { xs.resize(size, value.x); ys.resize(size, value.y); }
+    inline void clear() { xs.clear(); ys.clear(); }
+
+    inline void push_back(Vector2<T> vec) { xs.push_back(vec.x); ys.push_back(vec.y); }
+    inline void pop_back() { xs.pop_back(); ys.pop_back(); }
+
+    inline Vector2<T> operator[](size_t index) const { return {xs[index], ys[index]}; }
+    inline void set(size_t index, Vector2<T> vec) { xs[index] = vec.x; ys[index] = vec.y; }
+
+    inline T* x_data() { return xs.data(); }
+    inline T* y_data() { return ys.data(); }
+    inline const T* x_data() const { return xs.data(); }
+    inline const T* y_data() const { return ys.data(); }
+
+    /// @brief Converts back into an array of Vector2.
+    std::vector<Vector2<T>> to_vector() const
+    {
+        std::vector<Vector2<T>> vectors(size());
+        for (size_t i = 0; i < size(); i++) {
+            vectors[i] = {xs[i], ys[i]};
+        }
+        return vectors;
+    }
+
+    /// @brief Adds other array element-wise.
+    /// @warning Arrays must have the same size.
+    void add(const Vector2_array<T>& other)
+    {
+        if constexpr (simd) {
+            vector2_batch_add(xs.data(), ys.data(), other.xs.data(), other.ys.data(), size());
+        }
+        else {
+            for (size_t i = 0; i < size(); i++) {
+                xs[i] = static_cast<T>(xs[i] + other.xs[i]);
+                ys[i] = static_cast<T>(ys[i] + other.ys[i]);
+            }
+        }
+    }
+
+    /// @brief Adds the same offset to every element.
+    void add(Vector2<T> offset)
+    {
+        if constexpr (simd) {
+            vector2_batch_add(xs.data(), ys.data(), offset.x, offset.y, size());
+        }
+        else {
+            for (size_t i = 0; i < size(); i++) {
+                xs[i] = static_cast<T>(xs[i] + offset.x);
+                ys[i] = static_cast<T>(ys[i] + offset.y);
+            }
+        }
+    }
+
+    /// @brief Multiplies every element component-wise by factor.
+    void scale(Vector2<T> factor)
+    {
+        if constexpr (simd) {
+            vector2_batch_scale(xs.data(), ys.data(), factor.x, factor.y, size());
+        }
+        else {
+            for (size_t i = 0; i < size(); i++) {
+                xs[i] = static_cast<T>(xs[i] * factor.x);
+                ys[i] = static_cast<T>(ys[i] * factor.y);
+            }
+        }
+    }
+    inline void scale(T factor) { scale(Vector2<T>(factor, factor)); }
+
+    /// @brief Computes dot product of each element with corresponding element of other.
+    void dot(const Vector2_array<T>& other, std::vector<T>& out) const
+    {
+        out.resize(size());
+        if constexpr (simd) {
+            vector2_batch_dot(xs.data(), ys.data(), other.xs.data(), other.ys.data(), out.data(), size());
+        }
+        else {
+            for (size_t i = 0; i < size(); i++) {
+                out[i] = static_cast<T>(xs[i] * other.xs[i] + ys[i] * other.ys[i]);
+            }
+        }
+    }
+
+    /// @brief Euclidean length of every element.
+    void len(std::vector<Length>& out) const
+    {
+        out.resize(size());
+        if constexpr (simd) {
+            vector2_batch_len(xs.data(), ys.data(), out.data(), size());
+        }
+        else {
+            for (size_t i = 0; i < size(); i++) {
+                out[i] = Vector2<T>(xs[i], ys[i]).len();
+            }
+        }
+    }
+
+    /// @brief Scales every non-zero element to unit length. Zero vectors are left as is.
+    void normalize()
+    {
+        static_assert(std::is_floating_point<T>::value, "Vector2_array::normalize() requires a floating point type.");
+
+        if constexpr (simd) {
+            vector2_batch_normalize(xs.data(), ys.data(), size());
+        }
+        else {
+            for (size_t i = 0; i < size(); i++) {
+                T length = static_cast<T>(Vector2<T>(xs[i], ys[i]).len());
+                if (length > 0) {
+                    xs[i] /= length;
+                    ys[i] /= length;
+                }
+            }
+        }
+    }
+
+    /// @brief Clamps every element like Vector2::clamp, EXCLUDING THE UPPER BOUND
+    void clamp(Vector2<T> upper_bound, Vector2<T> lower_bound = {0, 0})
+    {
+        if constexpr (simd) {
+            vector2_batch_clamp(xs.data(), ys.data(), upper_bound, lower_bound, size());
+        }
+        else {
+            for (size_t i = 0; i < size(); i++) {
+                set(i, (*this)[i].clamp(upper_bound, lower_bound));
+            }
+        }
+    }
+
+    /// @brief manhattan (taxicab) metric length of every element.
+    void len_manh(std::vector<T>& out) const
+    {
+        out.resize(size());
+        if constexpr (simd) {
+            vector2_batch_len_manh(xs.data(), ys.data(), out.data(), size());
+        }
+        else {
+            for (size_t i = 0; i < size(); i++) {
+                out[i] = Vector2<T>(xs[i], ys[i]).len_manh();
+            }
+        }
+    }
+
+    /// @brief chessboard (chebyshev) metric length of every element.
+    void len_chess(std::vector<T>& out) const
+    {
+        out.resize(size());
+        if constexpr (simd) {
+            vector2_batch_len_chess(xs.data(), ys.data(), out.data(), size());
+        }
+        else {
+            for (size_t i = 0; i < size(); i++) {
+                out[i] = Vector2<T>(xs[i], ys[i]).len_chess();
+            }
+        }
+    }
+};
+
+typedef Vector2_array<int32_t> Vector2i_array;
+typedef Vector2_array<float> Vector2f_array;
+typedef Vector2_array<double> Vector2d_array;
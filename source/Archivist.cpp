@@ -1,4 +1,55 @@
 #include <sztronics/miscellaneous/Archivist.hpp>
+#include <sztronics/miscellaneous/Profiler.hpp>
+
+#include <thread>
+#include <condition_variable>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <string_view>
+
+/// @brief One call made through the *_async methods.
+struct Archivist::Io_request
+{
+    enum class Kind { Get, Put, Del, Purge } kind;
+    std::string locator;
+    Serialized value;
+    uint64_t expires_at = 0;
+    std::promise<std::optional<Serialized>> read_result; // Get
+    Read_completion on_read;                             // Get, instead of read_result when set
+    std::promise<bool> write_result;                     // Put, Del
+
+    /// @brief Hands the result of a Get to on_read or read_result.
+    void finish_read(std::optional<Serialized>& result, std::exception_ptr error)
+    {
+        if (on_read) {
+            on_read(result, error);
+        }
+        else if (error) {
+            read_result.set_exception(error);
+        }
+        else {
+            read_result.set_value(std::move(result));
+        }
+    }
+};
+
+struct Archivist::Snapshot_state
+{
+    uint64_t taken_at;
+    /// Locators written since the snapshot was taken, with their entries as they were then;
+    /// nothing if they didn't exist.
+    std::unordered_map<std::string, std::optional<Storage_entry>> preserved;
+};
+
+struct Archivist::Io_worker
+{
+    std::mutex queue_mutex;
+    std::condition_variable queue_changed;
+    std::deque<Io_request> queue;
+    bool running = true;
+    std::thread thread;
+};
 
 Archivist::Archivist(std::string storage_file) : filename(storage_file)
 {   
@@ -28,11 +79,22 @@ Archivist::Archivist(std::string storage_file) : filename(storage_file)
         file.write((char*)&n_entries, sizeof(n_entries));
         file.flush();
     }
+    load_filter();
 }
 
 Archivist::~Archivist() {
+    if (io_worker) {
+        // The worker finishes every queued request before it exits
+        {
+            std::lock_guard<std::mutex> lock(io_worker->queue_mutex);
+            io_worker->running = false;
+        }
+        io_worker->queue_changed.notify_one();
+        io_worker->thread.join();
+    }
     file.flush();
     file.close();
+    save_filter();
 }
 
 Archivist& Archivist::get_default()
@@ -41,6 +103,152 @@ Archivist& Archivist::get_default()
     return storage_manager;
 }
 
+// Locator filter _________________________________________________________________________________
+
+static const char filter_magic[8] = {'S', 'Z', 'B', 'L', 'O', 'O', 'M', '1'};
+
+/// @brief Identifies one state of the archive file. A saved filter is only used if its stamp still matches.
+struct Filter_stamp
+{
+    uint64_t file_size;
+    int64_t modified;
+    int32_t n_entries;
+
+    bool operator==(const Filter_stamp& other) const
+    {
+        return file_size == other.file_size && modified == other.modified && n_entries == other.n_entries;
+    }
+};
+
+/// @return Stamp of the file as it is on disk now, or nothing if it can't be read.
+static std::optional<Filter_stamp> current_stamp(const std::string& filename, int n_entries)
+{
+    std::error_code error;
+    uint64_t file_size = std::filesystem::file_size(filename, error);
+    if (error) {
+        return {};
+    }
+    std::filesystem::file_time_type modified = std::filesystem::last_write_time(filename, error);
+    if (error) {
+        return {};
+    }
+    return Filter_stamp{file_size, static_cast<int64_t>(modified.time_since_epoch().count()), n_entries};
+}
+
+void Archivist::load_filter()
+{
+    std::string filter_filename = filename + ARCHIVIST_FILTER_SUFFIX;
+    std::ifstream in(filter_filename, std::ios::binary);
+    std::optional<Filter_stamp> stamp = current_stamp(filename, n_entries);
+
+    char magic[sizeof(filter_magic)];
+    Filter_stamp saved_stamp;
+    uint32_t n_hashes;
+    uint64_t capacity, n_words;
+
+    in.read(magic, sizeof(magic));
+    in.read((char*)&saved_stamp.file_size, sizeof(saved_stamp.file_size));
+    in.read((char*)&saved_stamp.modified, sizeof(saved_stamp.modified));
+    in.read((char*)&saved_stamp.n_entries, sizeof(saved_stamp.n_entries));
+    in.read((char*)&n_hashes, sizeof(n_hashes));
+    in.read((char*)&capacity, sizeof(capacity));
+    in.read((char*)&n_words, sizeof(n_words));
+
+    // The words must all be in the file, so a corrupt count can't allocate more than that
+    std::error_code error;
+    uint64_t filter_size = std::filesystem::file_size(filter_filename, error);
+    std::streamoff header_size = in.tellg();
+    bool words_fit = !error && header_size >= 0 && 
+                     n_words <= (filter_size - std::min<uint64_t>(filter_size, header_size)) / sizeof(uint64_t);
+
+    if (in && stamp.has_value() && std::equal(magic, magic + sizeof(magic), filter_magic) && 
+        saved_stamp == stamp.value() && words_fit) {
+        std::vector<uint64_t> words(n_words);
+        in.read((char*)words.data(), n_words * sizeof(uint64_t));
+        if (in && locator_filter.assign(std::move(words), n_hashes, capacity)) {
+            n_filter_stale = 0;
+            return;
+        }
+    }
+    rebuild_filter();
+}
+
+void Archivist::rebuild_filter()
+{
+    PROFILE_ZONE("Archivist::rebuild_filter");
+    locator_filter.reset(std::max(2 * n_entries, ARCHIVIST_FILTER_MIN_CAPACITY));
+    n_filter_stale = 0;
+
+    // Same walk as locate_entry(), so the filter covers exactly the entries it can find
+    file.seekg(4);
+    Entry_header header;
+    std::string locator;
+
+    while (read_header(header)) {
+        locator.resize(header.locator_size);
+        file.read(locator.data(), header.locator_size);
+        if (file.fail() || file.eof()) {
+            break;
+        }
+        locator_filter.insert(locator);
+        file.seekg((unsigned)file.tellg() + header.data_size);
+    }
+    file.clear();
+}
+
+void Archivist::maintain_filter()
+{
+    if (static_cast<size_t>(n_entries + n_filter_stale) > locator_filter.get_capacity()) {
+        rebuild_filter();
+    }
+}
+
+void Archivist::save_filter()
+{
+    std::optional<Filter_stamp> stamp = current_stamp(filename, n_entries);
+    std::string filter_filename = filename + ARCHIVIST_FILTER_SUFFIX;
+    if (!stamp.has_value()) {
+        std::error_code error;
+        std::filesystem::remove(filter_filename, error);
+        return;
+    }
+    const std::vector<uint64_t>& words = locator_filter.get_words();
+    uint32_t n_hashes = locator_filter.get_n_hashes();
+    uint64_t capacity = locator_filter.get_capacity();
+    uint64_t n_words = words.size();
+
+    // A partly written filter fails the size checks in load_filter(), so it is never trusted
+    std::ofstream out(filter_filename, std::ios::binary | std::ios::trunc);
+    out.write(filter_magic, sizeof(filter_magic));
+    out.write((char*)&stamp->file_size, sizeof(stamp->file_size));
+    out.write((char*)&stamp->modified, sizeof(stamp->modified));
+    out.write((char*)&stamp->n_entries, sizeof(stamp->n_entries));
+    out.write((char*)&n_hashes, sizeof(n_hashes));
+    out.write((char*)&capacity, sizeof(capacity));
+    out.write((char*)&n_words, sizeof(n_words));
+    out.write((char*)words.data(), n_words * sizeof(uint64_t));
+}
+
+// Entries __________________________________________________________________________________________
+
+uint64_t Archivist::now_ms()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+bool Archivist::read_header(Entry_header& header)
+{
+    file.read((char*)&header.locator_size, sizeof(header.locator_size));
+    file.read((char*)&header.data_size, sizeof(header.data_size));
+    header.expires_at = 0;
+    if (header.locator_size & ARCHIVIST_EXPIRY_FLAG) {
+        header.locator_size &= ~ARCHIVIST_EXPIRY_FLAG;
+        file.read((char*)&header.expires_at, sizeof(header.expires_at));
+    }
+    return !(file.fail() || file.eof());
+}
+
 std::optional<unsigned> Archivist::next_entry(unsigned prev_pos)
 {
     file.seekg(prev_pos);
@@ -49,18 +257,13 @@ std::optional<unsigned> Archivist::next_entry(unsigned prev_pos)
         return {};
     }
 
-    unsigned short locator_size;
-    unsigned int data_size;
-
-    file.read((char*)&locator_size, sizeof(locator_size));
-    file.read((char*)&data_size, sizeof(data_size));
-
-    if (file.fail() || file.eof()) {
+    Entry_header header;
+    if (!read_header(header)) {
         file.clear();
         return {};
     }
 
-    file.seekg(locator_size + data_size, std::ios::cur);
+    file.seekg(header.locator_size + header.data_size, std::ios::cur);
 
     if (file.fail() || file.eof()) {
         file.clear();
@@ -94,38 +297,40 @@ std::optional<unsigned> Archivist::locate_idx(int index)
     return {(unsigned)file.tellg()};
 }
 
-std::optional<unsigned> Archivist::locate_entry(std::string locator)
+std::optional<unsigned> Archivist::locate_entry(std::string locator, Entry_header* found_header)
 {
+    PROFILE_ZONE("Archivist::locate_entry");
+    if (!locator_filter.may_contain(locator)) {
+        return {};
+    }
     file.seekg(4);
     
     if (file.fail() || file.eof()) {
         file.clear();
         return {};
     }
-    unsigned short locator_size;
-    unsigned int data_size;
+    Entry_header header;
+    std::string entry_locator;
 
     while (true) {
-
-        file.read((char*)&locator_size, sizeof(locator_size));
-        file.read((char*)&data_size, sizeof(data_size));
-
-        if (file.fail() || file.eof()) {
+        if (!read_header(header)) {
             file.clear();
             return {};
         }
-        std::string entry_locator;
-        entry_locator.resize(locator_size);
+        entry_locator.resize(header.locator_size);
 
-        file.read(entry_locator.data(), locator_size);
+        file.read(entry_locator.data(), header.locator_size);
         if (file.fail() || file.eof()) {
             file.clear();
             return {};
         }
         if (entry_locator == locator) {
-            return (unsigned)file.tellg() - sizeof(locator_size) - sizeof(data_size) - locator_size;
+            if (found_header) {
+                *found_header = header;
+            }
+            return (unsigned)file.tellg() - header.size() - header.locator_size;
         }
-        file.seekg((unsigned)file.tellg() + data_size);
+        file.seekg((unsigned)file.tellg() + header.data_size);
     }
 }
 
@@ -138,19 +343,15 @@ std::optional<Serialized> Archivist::read_entry_at(unsigned at_pos)
         file.clear();
         return {};
     }
-    unsigned short locator_size;
-    unsigned int data_size;
-
-    file.read((char*)&locator_size, sizeof(locator_size));
-    file.read((char*)&data_size, sizeof(data_size));
-    if (file.fail() || file.eof()) {
+    Entry_header header;
+    if (!read_header(header)) {
         file.clear();
         return {};
     }
-    data.resize(data_size);
+    data.resize(header.data_size);
 
-    file.seekg(locator_size, std::ios::cur);
-    file.read(data.data(), data_size);
+    file.seekg(header.locator_size, std::ios::cur);
+    file.read(data.data(), header.data_size);
 
     if (file.fail() || file.eof()) {
         file.clear();
@@ -160,6 +361,22 @@ std::optional<Serialized> Archivist::read_entry_at(unsigned at_pos)
     return {data};
 }
 
+/// @brief Writes one entry in the storage file format at the current write position.
+static void write_entry(std::ostream& out, const std::string& locator, const std::vector<char>& data, uint64_t expires_at)
+{
+    unsigned short locator_size = locator.size();
+    unsigned short flagged_size = locator_size | (expires_at ? ARCHIVIST_EXPIRY_FLAG : 0);
+    unsigned int data_size = data.size();
+
+    out.write((char*)&flagged_size, sizeof(flagged_size));
+    out.write((char*)&data_size, sizeof(data_size));
+    if (expires_at) {
+        out.write((char*)&expires_at, sizeof(expires_at));
+    }
+    out.write(locator.data(), locator_size);
+    out.write(data.data(), data_size);
+}
+
 bool Archivist::write_entry_at(unsigned at_pos, Archivist::Storage_entry& entry)
 {
     file.seekp(at_pos);
@@ -167,60 +384,311 @@ bool Archivist::write_entry_at(unsigned at_pos, Archivist::Storage_entry& entry)
         file.clear();
         return false;
     }
-    unsigned short locator_size = entry.locator.size();
-    unsigned int data_size = entry.data.size();
-
-    file.write((char*)&locator_size, sizeof(locator_size));
-    file.write((char*)&data_size, sizeof(data_size));
-    file.write(entry.locator.data(), locator_size);
-    file.write(entry.data.data(), data_size);
+    write_entry(file, entry.locator, entry.data, entry.expires_at);
 
     file.flush();
     return !(file.fail() || file.eof());
 }
 
-std::optional<Serialized> Archivist::get_raw(std::string locator)
+std::optional<Serialized> Archivist::get_entry(std::string locator)
 {
-    std::optional<unsigned int> location = locate_entry(locator);
+    Entry_header header;
+    std::optional<unsigned int> location = locate_entry(locator, &header);
     if (!location.has_value()) {
         return {};
     }
+    if (header.expired(now_ms())) {
+        expired_entry_seen();
+        return {};
+    }
     Serialized data = read_entry_at(location.value()).value();
 
     return data;
 }
 
+void Archivist::get_entries(const std::vector<std::string>& locators, std::vector<std::optional<Serialized>>& results)
+{
+    PROFILE_ZONE("Archivist::get_entries");
+    results.assign(locators.size(), {});
+    // Indices of each locator still to be found; duplicates share one lookup
+    std::unordered_map<std::string_view, std::vector<size_t>> wanted;
+    for (size_t i = 0; i < locators.size(); i++) {
+        if (locator_filter.may_contain(locators[i])) {
+            wanted[locators[i]].push_back(i);
+        }
+    }
+    if (wanted.empty()) {
+        return;
+    }
+    uint64_t now = now_ms();
+    file.seekg(4);
+    Entry_header header;
+    std::string entry_locator;
+    int n_expired = 0;
+
+    while (!wanted.empty() && read_header(header)) {
+        entry_locator.resize(header.locator_size);
+        file.read(entry_locator.data(), header.locator_size);
+        if (file.fail() || file.eof()) {
+            break;
+        }
+        auto found = wanted.find(entry_locator);
+        if (found == wanted.end() || header.expired(now)) {
+            file.seekg((unsigned)file.tellg() + header.data_size);
+            if (found != wanted.end()) {
+                wanted.erase(found);
+                n_expired++;
+            }
+            continue;
+        }
+        Serialized data(header.data_size);
+        file.read(data.data(), header.data_size);
+        if (file.fail()) {
+            break;
+        }
+        for (size_t index : found->second) {
+            results[index] = data;
+        }
+        wanted.erase(found);
+    }
+    file.clear();
+    // Only once the scan is over, as a purge rewrites the file under it
+    if (n_expired > 0) {
+        expired_entry_seen(n_expired);
+    }
+}
+
+void Archivist::expired_entry_seen(int n_seen)
+{
+    // Reclaimed in batches, as removing a single entry rewrites the rest of the file anyway
+    n_expired_seen += n_seen;
+    if (n_expired_seen < ARCHIVIST_PURGE_THRESHOLD) {
+        return;
+    }
+    if (io_worker) {
+        n_expired_seen = 0;
+        Io_request request;
+        request.kind = Io_request::Kind::Purge;
+        enqueue(std::move(request));
+    }
+    else {
+        purge_entries();
+    }
+}
+
+std::optional<Serialized> Archivist::get_raw(std::string locator)
+{
+    std::lock_guard<std::mutex> lock(state_mutex);
+    return get_entry(locator);
+}
+
+std::vector<std::optional<Serialized>> Archivist::get_many_raw(const std::vector<std::string>& locators)
+{
+    std::lock_guard<std::mutex> lock(state_mutex);
+    std::vector<std::optional<Serialized>> results;
+    get_entries(locators, results);
+    return results;
+}
+
 bool Archivist::put_raw(std::string locator, std::vector<char> value)
 {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    return put_entry(locator, value, 0);
+}
+
+/// @return Expiry time of an entry written now with given ttl.
+static uint64_t expiry_after(uint64_t now_ms, std::chrono::milliseconds ttl)
+{
+    // Never 0, which marks entries that don't expire
+    return std::max<int64_t>(1, static_cast<int64_t>(now_ms) + ttl.count());
+}
+
+bool Archivist::put_raw(std::string locator, Serialized value, std::chrono::milliseconds ttl)
+{
+    std::lock_guard<std::mutex> lock(state_mutex);
+    return put_entry(locator, value, expiry_after(now_ms(), ttl));
+}
+
+bool Archivist::del(std::string locator)
+{
+    std::lock_guard<std::mutex> lock(state_mutex);
+    return del_entry(locator);
+}
+
+int Archivist::purge_expired()
+{
+    std::lock_guard<std::mutex> lock(state_mutex);
+    return purge_entries();
+}
+
+// I/O thread _______________________________________________________________________________________
+
+void Archivist::enqueue(Io_request request)
+{
+    if (!io_worker) {
+        io_worker = std::make_unique<Io_worker>();
+        io_worker->thread = std::thread(&Archivist::run_io_worker, this);
+    }
+    std::lock_guard<std::mutex> lock(io_worker->queue_mutex);
+    io_worker->queue.push_back(std::move(request));
+    io_worker->queue_changed.notify_one();
+}
+
+std::future<std::optional<Serialized>> Archivist::get_raw_async(std::string locator)
+{
+    Io_request request;
+    request.kind = Io_request::Kind::Get;
+    request.locator = std::move(locator);
+    std::future<std::optional<Serialized>> result = request.read_result.get_future();
+
+    std::lock_guard<std::mutex> lock(state_mutex);
+    enqueue(std::move(request));
+    return result;
+}
+
+void Archivist::get_raw_async(std::string locator, Read_completion completion)
+{
+    Io_request request;
+    request.kind = Io_request::Kind::Get;
+    request.locator = std::move(locator);
+    request.on_read = std::move(completion);
+
+    std::lock_guard<std::mutex> lock(state_mutex);
+    enqueue(std::move(request));
+}
+
+std::future<bool> Archivist::put_raw_async(std::string locator, Serialized value)
+{
+    Io_request request;
+    request.kind = Io_request::Kind::Put;
+    request.locator = std::move(locator);
+    request.value = std::move(value);
+    std::future<bool> result = request.write_result.get_future();
+
+    std::lock_guard<std::mutex> lock(state_mutex);
+    enqueue(std::move(request));
+    return result;
+}
+
+std::future<bool> Archivist::put_raw_async(std::string locator, Serialized value, std::chrono::milliseconds ttl)
+{
+    Io_request request;
+    request.kind = Io_request::Kind::Put;
+    request.locator = std::move(locator);
+    request.value = std::move(value);
+    request.expires_at = expiry_after(now_ms(), ttl);
+    std::future<bool> result = request.write_result.get_future();
+
+    std::lock_guard<std::mutex> lock(state_mutex);
+    enqueue(std::move(request));
+    return result;
+}
+
+std::future<bool> Archivist::del_async(std::string locator)
+{
+    Io_request request;
+    request.kind = Io_request::Kind::Del;
+    request.locator = std::move(locator);
+    std::future<bool> result = request.write_result.get_future();
+
+    std::lock_guard<std::mutex> lock(state_mutex);
+    enqueue(std::move(request));
+    return result;
+}
+
+void Archivist::run_io_worker()
+{
+    std::vector<Io_request> batch;
+    std::vector<std::string> locators;
+    std::vector<std::optional<Serialized>> results;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(io_worker->queue_mutex);
+            io_worker->queue_changed.wait(lock, [this]() { 
+                return !io_worker->queue.empty() || !io_worker->running; 
+            });
+            if (io_worker->queue.empty()) {
+                break;
+            }
+            std::move(io_worker->queue.begin(), io_worker->queue.end(), std::back_inserter(batch));
+            io_worker->queue.clear();
+        }
+
+        std::lock_guard<std::mutex> lock(state_mutex);
+        for (size_t i = 0; i < batch.size();) {
+            Io_request& request = batch[i];
+            if (request.kind == Io_request::Kind::Get) {
+                // Gather reads up to the next write, so each one still sees every write made before it
+                size_t run_end = i;
+                locators.clear();
+                while (run_end < batch.size() && batch[run_end].kind == Io_request::Kind::Get) {
+                    locators.push_back(std::move(batch[run_end].locator));
+                    run_end++;
+                }
+                std::exception_ptr error;
+                try {
+                    get_entries(locators, results);
+                }
+                catch (...) {
+                    error = std::current_exception();
+                    results.assign(run_end - i, {});
+                }
+                for (size_t j = i; j < run_end; j++) {
+                    batch[j].finish_read(results[j - i], error);
+                }
+                i = run_end;
+                continue;
+            }
+            try {
+                switch (request.kind) {
+                    case Io_request::Kind::Put:
+                        request.write_result.set_value(put_entry(request.locator, request.value, request.expires_at));
+                        break;
+                    case Io_request::Kind::Del:
+                        request.write_result.set_value(del_entry(request.locator));
+                        break;
+                    default:
+                        purge_entries();
+                        break;
+                }
+            }
+            catch (...) {
+                request.write_result.set_exception(std::current_exception());
+            }
+            i++;
+        }
+        batch.clear();
+    }
+}
+
+// Writes ___________________________________________________________________________________________
+
+bool Archivist::put_entry(std::string locator, std::vector<char> value, uint64_t expires_at)
+{
+    if (locator.size() > ARCHIVIST_MAX_LOCATOR_SIZE) {
+        return false;
+    }
     Storage_entry entry;
     entry.locator = locator;
     entry.data = value;
+    entry.expires_at = expires_at;
 
     file.seekp(0, std::ios::end);
-    std::optional<unsigned> write_position = locate_entry(locator);
+    Entry_header header;
+    std::optional<unsigned> write_position = locate_entry(locator, &header);
+    preserve_for_snapshots(locator, write_position, header);
 
     // key already exists
     if(write_position.has_value()) {
-        // check data size
-        unsigned int data_size;
-        file.seekg(sizeof(unsigned short) + write_position.value());
-        file.read((char*)&data_size, sizeof(unsigned int));
-        // if same, write new data over
-        if (data_size == value.size()) {
+        // if the header and data sizes are the same, write new data over
+        if (header.data_size == value.size() && (header.expires_at != 0) == (expires_at != 0)) {
             return write_entry_at(write_position.value(), entry);
         }
         else { // if different, delete entry and add it again as if it was new
-            if(!del(locator)) {
+            if(!del_entry(locator)) {
                 return false;
             }
-            n_entries++; // entry was not deleted -- increment counter
-            file.seekp(0);
-            file.write((char*)&n_entries, sizeof(n_entries));
-            if (file.fail() || file.eof()) {
-                file.clear();
-                return false;
-            }
-            file.flush();
         }
     }
     // key does not exist or was erased
@@ -233,6 +701,7 @@ bool Archivist::put_raw(std::string locator, std::vector<char> value)
     if (!write_entry_at((unsigned)file.tellg(), entry)) {
         return false;
     }
+    locator_filter.insert(locator);
     // update entry count
     n_entries += 1;
     file.seekp(0);
@@ -242,16 +711,19 @@ bool Archivist::put_raw(std::string locator, std::vector<char> value)
         return false;
     }
     file.flush();
+    maintain_filter();
 
     return true;
 }
 
-bool Archivist::del(std::string locator)
+bool Archivist::del_entry(std::string locator)
 {
-    std::optional<unsigned> entry_loc = locate_entry(locator);
+    Entry_header header;
+    std::optional<unsigned> entry_loc = locate_entry(locator, &header);
     if (!entry_loc.has_value()) {
         return false;
     }
+    preserve_for_snapshots(locator, entry_loc, header);
     std::vector<char> buffer;
     unsigned new_file_size = 0;
 
@@ -290,8 +762,10 @@ bool Archivist::del(std::string locator)
     file.close();
     std::filesystem::resize_file(filename, new_file_size);
     file.open(filename, std::ios::in | std::ios::out | std::ios::binary);
+    layout_version++;
     // update entries counter
     n_entries--;
+    n_filter_stale++;
     file.seekp(0);
     file.write((char*)&n_entries, sizeof(n_entries));
     if (file.fail()) {
@@ -299,5 +773,287 @@ bool Archivist::del(std::string locator)
         return false;
     }
     file.flush();
+    maintain_filter();
     return true;
-}
\ No newline at end of file
+}
+
+void Archivist::seal_purge_gap(unsigned write_pos, unsigned read_pos, int n_removed)
+{
+    // The gap only held removed expired entries, so it has room for an expiring header
+    unsigned short flagged_size = 0 | ARCHIVIST_EXPIRY_FLAG;
+    unsigned int data_size = read_pos - write_pos - sizeof(flagged_size) - sizeof(data_size) - sizeof(uint64_t);
+    uint64_t expires_at = 1;
+    file.seekp(write_pos);
+    file.write((char*)&flagged_size, sizeof(flagged_size));
+    file.write((char*)&data_size, sizeof(data_size));
+    file.write((char*)&expires_at, sizeof(expires_at));
+
+    layout_version++;
+    n_entries -= n_removed - 1;
+    file.seekp(0);
+    file.write((char*)&n_entries, sizeof(n_entries));
+    file.flush();
+    file.clear();
+    rebuild_filter();
+}
+
+int Archivist::purge_entries()
+{
+    PROFILE_ZONE("Archivist::purge_expired");
+    uint64_t now = now_ms();
+    unsigned read_pos = 4;
+    unsigned write_pos = 4;
+    int n_removed = 0;
+    Entry_header header;
+    std::vector<char> buffer;
+
+    // Slide every live entry back over the expired ones before it, in one pass
+    while (true) {
+        file.seekg(read_pos);
+        if (!read_header(header)) {
+            file.clear();
+            break;
+        }
+        unsigned entry_size = header.size() + header.locator_size + header.data_size;
+        if (header.expired(now)) {
+            if (!snapshots.empty()) {
+                Storage_entry entry;
+                entry.locator.resize(header.locator_size);
+                entry.data.resize(header.data_size);
+                entry.expires_at = header.expires_at;
+                file.read(entry.locator.data(), header.locator_size);
+                file.read(entry.data.data(), header.data_size);
+                if (!file.fail()) {
+                    preserve_expired(entry);
+                }
+                file.clear();
+            }
+            n_removed++;
+        }
+        else {
+            if (write_pos != read_pos) {
+                buffer.resize(entry_size);
+                file.seekg(read_pos);
+                file.read(buffer.data(), entry_size);
+                if (file.fail()) {
+                    file.clear();
+                    seal_purge_gap(write_pos, read_pos, n_removed);
+                    return -1;
+                }
+                file.seekp(write_pos);
+                file.write(buffer.data(), entry_size);
+                if (file.fail()) {
+                    file.clear();
+                    return -1;
+                }
+            }
+            write_pos += entry_size;
+        }
+        read_pos += entry_size;
+    }
+    n_expired_seen = 0;
+    if (n_removed == 0) {
+        return 0;
+    }
+
+    // resize file, then reopen it
+    file.close();
+    std::filesystem::resize_file(filename, write_pos);
+    file.open(filename, std::ios::in | std::ios::out | std::ios::binary);
+    layout_version++;
+    n_entries -= n_removed;
+    file.seekp(0);
+    file.write((char*)&n_entries, sizeof(n_entries));
+    if (file.fail()) {
+        file.clear();
+        return -1;
+    }
+    file.flush();
+    rebuild_filter();
+    return n_removed;
+}
+
+// Snapshots ________________________________________________________________________________________
+
+Archivist::Snapshot Archivist::snapshot()
+{
+    std::shared_ptr<Snapshot_state> state = std::make_shared<Snapshot_state>();
+    std::lock_guard<std::mutex> lock(state_mutex);
+    state->taken_at = now_ms();
+    // Forget destroyed snapshots only when the list would grow, which keeps this amortized O(1)
+    if (snapshots.size() == snapshots.capacity()) {
+        snapshots.erase(std::remove_if(snapshots.begin(), snapshots.end(), 
+                        [](const std::weak_ptr<Snapshot_state>& snapshot) { return snapshot.expired(); }), 
+                        snapshots.end());
+    }
+    snapshots.push_back(state);
+    return Snapshot(*this, state);
+}
+
+std::vector<std::shared_ptr<Archivist::Snapshot_state>> Archivist::snapshots_missing(const std::string& locator)
+{
+    std::vector<std::shared_ptr<Snapshot_state>> missing;
+    if (snapshots.empty()) {
+        return missing;
+    }
+    snapshots.erase(std::remove_if(snapshots.begin(), snapshots.end(), 
+                    [](const std::weak_ptr<Snapshot_state>& snapshot) { return snapshot.expired(); }), 
+                    snapshots.end());
+    for (std::weak_ptr<Snapshot_state>& snapshot : snapshots) {
+        std::shared_ptr<Snapshot_state> state = snapshot.lock();
+        if (state && state->preserved.count(locator) == 0) {
+            missing.push_back(std::move(state));
+        }
+    }
+    return missing;
+}
+
+void Archivist::preserve_for_snapshots(const std::string& locator, std::optional<unsigned> location, 
+                                       const Entry_header& header)
+{
+    std::vector<std::shared_ptr<Snapshot_state>> missing = snapshots_missing(locator);
+    if (missing.empty()) {
+        return;
+    }
+    std::optional<Storage_entry> current;
+    if (location.has_value()) {
+        std::optional<Serialized> data = read_entry_at(location.value());
+        if (data.has_value()) {
+            current = Storage_entry{locator, std::move(data.value()), header.expires_at};
+        }
+    }
+    for (std::shared_ptr<Snapshot_state>& state : missing) {
+        state->preserved.emplace(locator, current);
+    }
+}
+
+void Archivist::preserve_expired(const Storage_entry& entry)
+{
+    for (std::shared_ptr<Snapshot_state>& state : snapshots_missing(entry.locator)) {
+        // Snapshots taken after it expired never saw it
+        if (state->taken_at < entry.expires_at) {
+            state->preserved.emplace(entry.locator, entry);
+        }
+    }
+}
+
+Archivist::Snapshot::Snapshot(Archivist& archivist, std::shared_ptr<Snapshot_state> state) 
+    : archivist(&archivist), state(std::move(state))
+{}
+
+uint64_t Archivist::Snapshot::get_time() const
+{
+    return state->taken_at;
+}
+
+std::optional<Serialized> Archivist::Snapshot::get_raw(std::string locator)
+{
+    std::lock_guard<std::mutex> lock(archivist->state_mutex);
+    auto found = state->preserved.find(locator);
+    if (found != state->preserved.end()) {
+        const std::optional<Storage_entry>& entry = found->second;
+        if (!entry.has_value() || (entry->expires_at != 0 && entry->expires_at <= state->taken_at)) {
+            return {};
+        }
+        return entry->data;
+    }
+    // Not written since the snapshot, so the file still holds it as it was
+    Entry_header header;
+    std::optional<unsigned> location = archivist->locate_entry(locator, &header);
+    if (!location.has_value() || header.expired(state->taken_at)) {
+        return {};
+    }
+    return archivist->read_entry_at(location.value());
+}
+
+void Archivist::Snapshot::visit(const std::function<void(const Storage_entry&)>& fn)
+{
+    // Locators already passed to fn, so a rescan after entries moved doesn't repeat them
+    std::unordered_set<std::string> visited;
+    std::vector<Storage_entry> batch;
+    std::optional<uint64_t> layout_version;
+    unsigned position = 4;
+    bool at_end = false;
+
+    while (!at_end) {
+        {
+            std::lock_guard<std::mutex> lock(archivist->state_mutex);
+            std::fstream& file = archivist->file;
+            if (layout_version != archivist->layout_version) {
+                position = 4;
+                layout_version = archivist->layout_version;
+            }
+            file.seekg(position);
+            Entry_header header;
+
+            for (int i = 0; i < ARCHIVIST_SNAPSHOT_BATCH; i++) {
+                if (!archivist->read_header(header)) {
+                    at_end = true;
+                    break;
+                }
+                Storage_entry entry;
+                entry.locator.resize(header.locator_size);
+                file.read(entry.locator.data(), header.locator_size);
+                if (file.fail() || file.eof()) {
+                    at_end = true;
+                    break;
+                }
+                // Locators written since the snapshot are visited from their preserved entries below
+                if (header.expired(state->taken_at) || state->preserved.count(entry.locator) != 0 ||
+                    !visited.insert(entry.locator).second) {
+                    file.seekg(header.data_size, std::ios::cur);
+                    continue;
+                }
+                entry.data.resize(header.data_size);
+                entry.expires_at = header.expires_at;
+                file.read(entry.data.data(), header.data_size);
+                if (file.fail()) {
+                    at_end = true;
+                    break;
+                }
+                batch.push_back(std::move(entry));
+            }
+            position = (unsigned)file.tellg();
+            file.clear();
+        }
+        for (const Storage_entry& entry : batch) {
+            fn(entry);
+        }
+        batch.clear();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(archivist->state_mutex);
+        for (const auto& [locator, entry] : state->preserved) {
+            if (entry.has_value() && (entry->expires_at == 0 || entry->expires_at > state->taken_at) &&
+                visited.count(locator) == 0) {
+                batch.push_back(entry.value());
+            }
+        }
+    }
+    for (const Storage_entry& entry : batch) {
+        fn(entry);
+    }
+}
+
+void Archivist::Snapshot::for_each(const std::function<void(const std::string& locator, const Serialized& value)>& fn)
+{
+    visit([&](const Storage_entry& entry) {
+        fn(entry.locator, entry.data);
+    });
+}
+
+bool Archivist::Snapshot::save_as(std::string storage_file)
+{
+    std::ofstream out(storage_file, std::ios::binary | std::ios::trunc);
+    int n_saved = 0;
+    out.write((char*)&n_saved, sizeof(n_saved));
+    visit([&](const Storage_entry& entry) {
+        write_entry(out, entry.locator, entry.data, entry.expires_at);
+        n_saved++;
+    });
+    out.seekp(0);
+    out.write((char*)&n_saved, sizeof(n_saved));
+    out.close();
+    return !out.fail();
+}
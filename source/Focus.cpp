@@ -1,60 +1,202 @@
 #include <sztronics/miscellaneous/Focus.hpp>
 
-Focus::Focus(Focus_scope& focus_space) : focus_space(focus_space)
+#include <algorithm>
+
+Focus::Focus_scope Focus::global_scope;
+
+Focus::Focus(Focus_scope& focus_space, int priority) : focus_space(focus_space), priority(priority)
 {
-    std::lock_guard<std::mutex> lock(focus_space.focus_mutex);
+    try_claim_control();
+}
 
-    if (focus_space.current_controller.has_value()) {
-        control = false;
-    }
-    else {
-        control = true;
-        focus_space.current_controller.emplace(std::ref(*this));
+Focus::~Focus()
+{
+    release_control();
+}
+
+// Focus_scope ____________________________________________________________________________________
+
+std::optional<std::reference_wrapper<Focus>> Focus::Focus_scope::get_controller()
+{
+    Focus* controller = current_controller.load(std::memory_order_acquire);
+    if (controller == nullptr) {
+        return {};
     }
+    return std::ref(*controller);
 }
 
-bool Focus::has_control()
+size_t Focus::Focus_scope::subscribe(Subscriber subscriber)
 {
-    std::lock_guard<std::mutex> lock(focus_space.focus_mutex);
-    return control;
+    std::lock_guard<std::mutex> lock(focus_mutex);
+    subscribers.emplace_back(++subscriber_counter, std::move(subscriber));
+    return subscriber_counter;
 }
 
-std::optional<std::reference_wrapper<Focus>> Focus::Focus_scope::get_controller()
+void Focus::Focus_scope::unsubscribe(size_t id)
 {
     std::lock_guard<std::mutex> lock(focus_mutex);
-    return current_controller;
+    subscribers.erase(std::remove_if(subscribers.begin(), subscribers.end(), 
+                      [id](const std::pair<size_t, Subscriber>& entry) { return entry.first == id; }),
+                      subscribers.end());
 }
 
-void Focus::claim_control()
+void Focus::Focus_scope::push(Focus& focus)
 {
-    std::lock_guard<std::mutex> lock(focus_space.focus_mutex);
+    remove(focus);
+    // Above every focus of the same priority
+    auto position = std::upper_bound(stack.begin(), stack.end(), focus.priority, 
+                                     [](int priority, const Focus* other) { return priority < other->priority; });
+    stack.insert(position, &focus);
+}
 
-    if (!control) {
-        if (focus_space.current_controller.has_value()) {
-            focus_space.current_controller->get().control = false;
+bool Focus::Focus_scope::remove(Focus& focus)
+{
+    auto found = std::find(stack.begin(), stack.end(), &focus);
+    if (found == stack.end()) {
+        return false;
+    }
+    stack.erase(found);
+    return true;
+}
+
+void Focus::Focus_scope::update_controller(std::unique_lock<std::mutex>& lock)
+{
+    Focus* previous = current_controller.load(std::memory_order_relaxed);
+    Focus* current = stack.empty() ? nullptr : stack.back();
+    if (previous == current) {
+        return;
+    }
+    current_controller.store(current, std::memory_order_release);
+
+    pending_changes.push_back({previous, current, 
+                               previous ? previous->lose_callback : nullptr, 
+                               current ? current->gain_callback : nullptr, 
+                               subscribers});
+    deliver(lock);
+}
+
+void Focus::Focus_scope::notify_moved(std::unique_lock<std::mutex>& lock, Focus* from, Focus* to)
+{
+    // Control didn't change hands, so only subscribers, who see addresses, hear about it
+    pending_changes.push_back({from, to, nullptr, nullptr, subscribers});
+    deliver(lock);
+}
+
+void Focus::Focus_scope::deliver(std::unique_lock<std::mutex>& lock)
+{
+    // Changes made meanwhile, including by the callbacks themselves, queue up behind this one
+    if (delivering) {
+        return;
+    }
+    delivering = true;
+    while (!pending_changes.empty()) {
+        Change change = std::move(pending_changes.front());
+        pending_changes.pop_front();
+
+        // Callbacks may claim or release focus themselves, so they run unlocked
+        lock.unlock();
+        if (change.lose_callback) {
+            change.lose_callback();
+        }
+        if (change.gain_callback) {
+            change.gain_callback();
         }
-        focus_space.current_controller.emplace(std::ref(*this));
-        control = true;
+        for (std::pair<size_t, Subscriber>& subscriber : change.subscribers) {
+            subscriber.second(change.previous, change.current);
+        }
+        lock.lock();
     }
+    delivering = false;
 }
 
+// Control ________________________________________________________________________________________
+
+void Focus::claim_control()
+{
+    std::unique_lock<std::mutex> lock(focus_space.focus_mutex);
+    focus_space.push(*this);
+    focus_space.update_controller(lock);
+}
+
+bool Focus::try_claim_control()
+{
+    std::unique_lock<std::mutex> lock(focus_space.focus_mutex);
+    if (!focus_space.stack.empty()) {
+        return focus_space.stack.back() == this;
+    }
+    focus_space.push(*this);
+    focus_space.update_controller(lock);
+    return true;
+}
+
+void Focus::release_control()
+{
+    std::unique_lock<std::mutex> lock(focus_space.focus_mutex);
+    if (focus_space.remove(*this)) {
+        focus_space.update_controller(lock);
+    }
+}
+
+void Focus::on_gain(std::function<void(void)> callback)
+{
+    std::lock_guard<std::mutex> lock(focus_space.focus_mutex);
+    gain_callback = std::move(callback);
+}
+
+void Focus::on_lose(std::function<void(void)> callback)
+{
+    std::lock_guard<std::mutex> lock(focus_space.focus_mutex);
+    lose_callback = std::move(callback);
+}
+
+// Moving _________________________________________________________________________________________
+
 Focus& Focus::operator=(Focus&& other)
 {
-    std::optional<std::lock_guard<std::mutex>> lock(other.focus_space.focus_mutex);
-    if (other.control) {
-        lock.reset();
+    if (&other == this) {
+        return *this;
+    }
+    release_control();
+
+    // Position on the stack moves along with the object
+    bool other_claimed;
+    {
+        std::unique_lock<std::mutex> lock(other.focus_space.focus_mutex);
+        priority = other.priority;
+        gain_callback = std::move(other.gain_callback);
+        lose_callback = std::move(other.lose_callback);
+
+        auto found = std::find(other.focus_space.stack.begin(), other.focus_space.stack.end(), &other);
+        other_claimed = found != other.focus_space.stack.end();
+        if (other_claimed && &other.focus_space == &focus_space) {
+            *found = this;
+            Focus* expected = &other;
+            if (focus_space.current_controller.compare_exchange_strong(expected, this, std::memory_order_acq_rel)) {
+                focus_space.notify_moved(lock, &other, this);
+            }
+            return *this;
+        }
+    }
+    if (other_claimed) { // Different scope: leave the old one, claim in ours
+        other.release_control();
         claim_control();
     }
-    
     return *this;
 }
 
 Focus::Focus(Focus&& other) : focus_space(other.focus_space)
 {
-    std::optional<std::lock_guard<std::mutex>> lock(other.focus_space.focus_mutex);
-    if (other.control) {
-        lock.reset();
-        claim_control();
-    }
-}
+    std::unique_lock<std::mutex> lock(focus_space.focus_mutex);
+    priority = other.priority;
+    gain_callback = std::move(other.gain_callback);
+    lose_callback = std::move(other.lose_callback);
 
+    auto found = std::find(focus_space.stack.begin(), focus_space.stack.end(), &other);
+    if (found != focus_space.stack.end()) {
+        *found = this;
+        Focus* expected = &other;
+        if (focus_space.current_controller.compare_exchange_strong(expected, this, std::memory_order_acq_rel)) {
+            focus_space.notify_moved(lock, &other, this);
+        }
+    }
+}
\ No newline at end of file
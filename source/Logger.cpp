@@ -1,4 +1,112 @@
 #include <sztronics/miscellaneous/Logger.hpp>
+#include <sztronics/miscellaneous/Spsc_ring.hpp>
+
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include <streambuf>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/mman.h>
+
+/// @brief streambuf that appends everything to a string.
+class Line_buffer : public std::streambuf
+{
+    public:
+    std::string line;
+
+    protected:
+    int_type overflow(int_type ch) override
+    {
+        if (ch != traits_type::eof()) {
+            line.push_back(traits_type::to_char_type(ch));
+        }
+        return ch;
+    }
+    std::streamsize xsputn(const char* data, std::streamsize size) override
+    {
+        line.append(data, size);
+        return size;
+    }
+};
+
+/// @brief Per-thread state of a logging thread.
+struct Producer
+{
+    Line_buffer buffer;
+    std::ostream stream{&buffer};
+    Serialized record;
+    std::shared_ptr<void> backend; // Keeps the backend that ring belongs to alive
+    std::shared_ptr<Spsc_ring<char>> ring;
+};
+
+static thread_local Producer producer;
+
+// Binary log file starts with this
+static const char binary_magic[8] = {'S', 'Z', 'L', 'O', 'G', 'v', '1', '\n'};
+
+// Formats of every LOG_BINARY call site; ID is index + 1
+static std::mutex formats_mutex;
+static std::vector<std::unique_ptr<const Logger::Format_info>> formats;
+
+/// @brief Last lines logged, in fixed-size slots: [u16 length][text].
+///        Kept outside of Logger so that the signal handler can reach it.
+struct Crash_ring
+{
+    std::atomic<bool> enabled = false;
+    std::unique_ptr<char[]> slots;
+    size_t n_slots = 0;
+    std::atomic<size_t> next = 0;
+    int dump_fd = -1;
+    struct sigaction previous_actions[NSIG];
+};
+
+static Crash_ring crash_ring;
+static const int fatal_signals[] = {SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT};
+
+struct Logger::Async_backend
+{
+    Overflow_policy policy;
+    size_t ring_size;
+    std::atomic<size_t> n_dropped = 0;
+    size_t n_reported = 0;
+
+    std::mutex rings_mutex; // Only taken when a thread logs for the first time
+    std::vector<std::shared_ptr<Spsc_ring<char>>> rings;
+
+    std::atomic<bool> running = true;
+    std::thread writer;
+
+    // The writer sleeps while every buffer is empty; the first push after that wakes it
+    std::atomic<bool> writer_idle = false;
+    std::mutex wake_mutex;
+    std::condition_variable wake_condition;
+
+    void wake_writer()
+    {
+        if (writer_idle.exchange(false)) {
+            std::lock_guard<std::mutex> lock(wake_mutex);
+            wake_condition.notify_one();
+        }
+    }
+
+    /// @return Whether the writer has something to do, i.e. must not go to sleep.
+    bool has_work()
+    {
+        if (!running.load() || (policy == Overflow_policy::Count && n_dropped.load() != n_reported)) {
+            return true;
+        }
+        std::lock_guard<std::mutex> lock(rings_mutex);
+        return std::any_of(rings.begin(), rings.end(), 
+                           [](const std::shared_ptr<Spsc_ring<char>>& ring) { return !ring->empty(); });
+    }
+};
 
 Logger& Logger::get()
 {
@@ -11,28 +119,663 @@ Logger::~Logger()
     disable();
 }
 
-void Logger::enable(const std::string& filename)
+static void write_all(int fd, const char* data, size_t size)
 {
-    if (logfile.has_value()) {
-        logfile->close();
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        data += written;
+        size -= written;
     }
-    logfile.emplace();
-    logfile->open(filename);
-    if (!logfile->is_open()) {
-        logfile.reset(); // Reset if the file couldn't be opened
+}
+
+void Logger::enable(const std::string& filename, Format format)
+{
+    disable();
+    std::lock_guard<std::mutex> lock(write_mutex);
+    this->filename = filename;
+    this->format = format;
+    rotation = next_rotation;
+    open_file();
+}
+
+void Logger::set_rotation(const Rotation& rotation)
+{
+    // The file being written keeps its rotation; this only takes effect in enable()
+    std::lock_guard<std::mutex> lock(write_mutex);
+    next_rotation = rotation;
+}
+
+// Files __________________________________________________________________________________________
+
+void Logger::open_file()
+{
+    // The new file replaces the old one in a single step, so other threads never see logging disabled
+    int new_fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    int old_fd = fd.exchange(new_fd);
+    if (old_fd >= 0) {
+        ::close(old_fd);
+    }
+    file_size = 0;
+    file_opened = std::chrono::steady_clock::now();
+    n_definitions_written = 0; // New file needs every definition again
+
+    if (new_fd < 0) {
+        return;
+    }
+    if (rotation.mapped) {
+        map_segment(rotation.max_size > 0 ? rotation.max_size : LOGGER_SEGMENT_SIZE);
+    }
+    if (format == Format::Binary) {
+        append_bytes(binary_magic, sizeof(binary_magic));
+    }
+}
+
+void Logger::close_file()
+{
+    std::lock_guard<std::mutex> lock(write_mutex); // Threads that saw async disabled may still be writing
+    unmap_segment();
+    int old_fd = fd.exchange(-1);
+    if (old_fd >= 0) {
+        ::close(old_fd);
+    }
+}
+
+bool Logger::map_segment(size_t size)
+{
+    if (mapping) {
+        ::munmap(mapping, mapping_size);
+        mapping = nullptr;
+        mapping_size = 0;
     }
+    void* mapped = MAP_FAILED;
+    if (::ftruncate(fd, size) == 0) {
+        mapped = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (mapped == MAP_FAILED) { // Continue with plain writes after what is already there
+        if (::ftruncate(fd, file_size) == 0) {
+            ::lseek(fd, file_size, SEEK_SET);
+        }
+        return false;
+    }
+    mapping = static_cast<char*>(mapped);
+    mapping_size = size;
+    return true;
+}
+
+void Logger::unmap_segment()
+{
+    if (!mapping) {
+        return;
+    }
+    ::munmap(mapping, mapping_size);
+    mapping = nullptr;
+    mapping_size = 0;
+    // On failure the file just keeps zero padding at the end
+    [[maybe_unused]] int result = ::ftruncate(fd, file_size);
+}
+
+void Logger::rotate_if_needed(size_t size)
+{
+    // A full segment is rotated even without a size limit
+    size_t limit = rotation.max_size > 0 ? rotation.max_size : mapping_size;
+    bool too_big = limit > 0 && file_size > 0 && file_size + size > limit;
+    bool too_old = rotation.max_age.count() > 0 && 
+                   std::chrono::steady_clock::now() - file_opened >= rotation.max_age;
+    if (!too_big && !too_old) {
+        return;
+    }
+    unmap_segment();
+
+    // With keep == 0 there is nothing to rename; open_file() truncates the current file
+    if (rotation.keep > 0) {
+        ::unlink((filename + '.' + std::to_string(rotation.keep)).c_str());
+        for (size_t i = rotation.keep - 1; i > 0; i--) {
+            ::rename((filename + '.' + std::to_string(i)).c_str(), (filename + '.' + std::to_string(i + 1)).c_str());
+        }
+        ::rename(filename.c_str(), (filename + ".1").c_str());
+    }
+    open_file();
+}
+
+void Logger::append_bytes(const char* data, size_t size)
+{
+    if (mapping && file_size + size > mapping_size) { // Only records larger than a whole segment get here
+        map_segment(file_size + size);
+    }
+    if (mapping) {
+        std::memcpy(mapping + file_size, data, size);
+    }
+    else {
+        write_all(fd, data, size);
+    }
+    file_size += size;
+}
+
+// Crash ring _____________________________________________________________________________________
+
+/// @brief Copies a line into the crash ring, if enabled. Plain stores only.
+static void record_crash_line(const char* data, size_t size)
+{
+    if (!crash_ring.enabled.load(std::memory_order_relaxed)) {
+        return;
+    }
+    size_t index = crash_ring.next.fetch_add(1, std::memory_order_relaxed) % crash_ring.n_slots;
+    char* slot = &crash_ring.slots[index * LOGGER_CRASH_RECORD_SIZE];
+    uint16_t length = std::min<size_t>(size, LOGGER_CRASH_RECORD_SIZE - sizeof(uint16_t));
+    std::memcpy(slot, &length, sizeof(length));
+    std::memcpy(slot + sizeof(length), data, length);
+}
+
+static void crash_signal_handler(int signal)
+{
+    Logger::dump_crash_ring();
+    // Let the previous handler (or the default action) deal with the signal
+    ::sigaction(signal, &crash_ring.previous_actions[signal], nullptr);
+    ::raise(signal);
+}
+
+void Logger::enable_crash_ring(const std::string& dump_filename, size_t n_records)
+{
+    if (crash_ring.enabled.load() || n_records == 0) {
+        return;
+    }
+    crash_ring.dump_fd = ::open(dump_filename.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (crash_ring.dump_fd < 0) {
+        return;
+    }
+    crash_ring.slots.reset(new char[n_records * LOGGER_CRASH_RECORD_SIZE]());
+    crash_ring.n_slots = n_records;
+    crash_ring.enabled.store(true);
+
+    struct sigaction action = {};
+    action.sa_handler = crash_signal_handler;
+    sigemptyset(&action.sa_mask);
+    for (int signal : fatal_signals) {
+        ::sigaction(signal, &action, &crash_ring.previous_actions[signal]);
+    }
+}
+
+void Logger::dump_crash_ring()
+{
+    if (!crash_ring.enabled.load(std::memory_order_relaxed)) {
+        return;
+    }
+    static const char header[] = "--- Last logged lines ---\n";
+    write_all(crash_ring.dump_fd, header, sizeof(header) - 1);
+
+    size_t next = crash_ring.next.load(std::memory_order_relaxed);
+    for (size_t i = next > crash_ring.n_slots ? next - crash_ring.n_slots : 0; i < next; i++) {
+        const char* slot = &crash_ring.slots[(i % crash_ring.n_slots) * LOGGER_CRASH_RECORD_SIZE];
+        uint16_t length;
+        std::memcpy(&length, slot, sizeof(length));
+        write_all(crash_ring.dump_fd, slot + sizeof(length), length);
+        if (length == 0 || slot[sizeof(length) + length - 1] != '\n') { // Cut off
+            write_all(crash_ring.dump_fd, "\n", 1);
+        }
+    }
+}
+
+void Logger::enable_async(const std::string& filename, Overflow_policy policy, size_t buffer_size, Format format)
+{
+    enable(filename, format);
+    if (fd < 0) {
+        return;
+    }
+    std::shared_ptr<Async_backend> backend = std::make_shared<Async_backend>();
+    backend->policy = policy;
+    backend->ring_size = buffer_size;
+
+    backend->writer = std::thread([this, backend = backend.get()]() {
+        std::vector<char> batch;
+        std::vector<std::shared_ptr<Spsc_ring<char>>> rings;
+
+        while (true) {
+            bool stopping = !backend->running.load(std::memory_order_acquire);
+            {
+                std::lock_guard<std::mutex> lock(backend->rings_mutex);
+                // Forget buffers of exited threads once they are drained
+                backend->rings.erase(std::remove_if(backend->rings.begin(), backend->rings.end(), 
+                                     [](const std::shared_ptr<Spsc_ring<char>>& ring) { 
+                                        return ring.use_count() == 1 && ring->empty(); 
+                                     }), backend->rings.end());
+                rings = backend->rings;
+            }
+            for (std::shared_ptr<Spsc_ring<char>>& ring : rings) {
+                for (auto span = ring->front_span(); span.second > 0; span = ring->front_span()) {
+                    batch.insert(batch.end(), span.first, span.first + span.second);
+                    ring->consume(span.second);
+                }
+            }
+            rings.clear();
+
+            size_t n_dropped = backend->n_dropped.load(std::memory_order_relaxed);
+            if (backend->policy == Overflow_policy::Count && n_dropped != backend->n_reported) {
+                std::string report = "[Logger: " + std::to_string(n_dropped - backend->n_reported) + " records dropped]\n";
+                if (this->format == Format::Binary) {
+                    append_record_header(batch, Record_kind::Text, 0, report.size());
+                }
+                batch.insert(batch.end(), report.begin(), report.end());
+                backend->n_reported = n_dropped;
+            }
+            if (!batch.empty()) {
+                write_out(batch.data(), batch.size());
+                batch.clear();
+            }
+            else if (stopping) {
+                break;
+            }
+            else { // Idle -- sleep until a producer pushes into an empty buffer or disable() is called
+                backend->writer_idle.store(true);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (backend->has_work()) { // Pushed before the flag was visible
+                    backend->writer_idle.store(false);
+                    continue;
+                }
+                std::unique_lock<std::mutex> lock(backend->wake_mutex);
+                backend->wake_condition.wait(lock, [backend]() { return !backend->writer_idle.load(); });
+            }
+        }
+    });
+
+    std::lock_guard<std::mutex> lock(async_mutex);
+    async = std::move(backend);
+    async_current.store(async.get(), std::memory_order_release);
 }
 
 void Logger::disable()
 {
-    if (logfile.has_value()) {
-        logfile->close();
+    std::shared_ptr<Async_backend> backend;
+    {
+        std::lock_guard<std::mutex> lock(async_mutex);
+        backend = std::move(async);
+        async_current.store(nullptr, std::memory_order_release);
+    }
+    if (backend) { // Producers still holding it only push into buffers nobody reads anymore
+        backend->running.store(false);
+        backend->writer_idle.store(true);
+        backend->wake_writer();
+        backend->writer.join(); // Drains what's left
+    }
+    close_file();
+}
+
+/// @brief Writes "[LEVEL category] " in front of a line.
+static void write_prefix(std::ostream& out, Log_level level, const std::string& category)
+{
+    out << '[' << Logger::level_name(level);
+    if (!category.empty()) {
+        out << ' ' << category;
+    }
+    out << "] ";
+}
+
+const char* Logger::level_name(Log_level level)
+{
+    static const char* const names[] = {"TRACE", "DEBUG", "INFO", "WARN", "ERROR", "FATAL", "OFF"};
+    size_t index = static_cast<size_t>(level);
+    return index < sizeof(names) / sizeof(names[0]) ? names[index] : "?";
+}
+
+void Logger::set_level(Log_level level)
+{
+    for (std::atomic<Log_level>& category_level : category_levels) {
+        category_level.store(level, std::memory_order_relaxed);
+    }
+}
+
+void Logger::set_category_name(uint8_t category, const std::string& name)
+{
+    category_names[clamp_category(category)] = name;
+}
+
+Logger::Line::Line(Log_level level, uint8_t category, size_t n_suppressed) : stream(line_stream())
+{
+    write_prefix(stream, level, Logger::get().category_names[clamp_category(category)]);
+    if (n_suppressed > 0) {
+        stream << '(' << n_suppressed << " suppressed) ";
     }
-    logfile.reset();
 }
 
-void Logger::flush() {
-    if (logfile.has_value()) {
-        logfile.value() << std::endl;
+Logger::Line::~Line()
+{
+    Logger::get().flush();
+}
+
+bool Log_rate_limiter::allow()
+{
+    int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+    int64_t start = window_start.load(std::memory_order_relaxed);
+
+    // The first thread to notice a new window resets the count
+    if (now - start >= 1000000000 && window_start.compare_exchange_strong(start, now, std::memory_order_relaxed)) {
+        n_in_window.store(0, std::memory_order_relaxed);
+    }
+    if (n_in_window.fetch_add(1, std::memory_order_relaxed) < max_per_second) {
+        return true;
+    }
+    n_suppressed.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+std::ostream& Logger::line_stream()
+{
+    return producer.stream;
+}
+
+void Logger::write_out(const char* data, size_t size)
+{
+    std::lock_guard<std::mutex> lock(write_mutex);
+    rotate_if_needed(size);
+
+    // Definitions must precede the first record that uses them
+    if (format == Format::Binary) {
+        std::vector<char> definitions;
+        append_definitions(definitions);
+        append_bytes(definitions.data(), definitions.size());
+    }
+    append_bytes(data, size);
+}
+
+void Logger::flush() 
+{
+    std::string& line = producer.buffer.line;
+    if (fd < 0) {
+        line.clear();
+        return;
+    }
+    line.push_back('\n');
+    record_crash_line(line.data(), line.size());
+
+    if (format == Format::Binary) {
+        Serialized& record = producer.record;
+        record.clear();
+        append_record_header(record, Record_kind::Text, 0, line.size());
+        record.insert(record.end(), line.begin(), line.end());
+        submit(record.data(), record.size());
+    }
+    else {
+        submit(line.data(), line.size());
+    }
+    line.clear();
+}
+
+void Logger::submit(const char* data, size_t size)
+{
+    Async_backend* backend = async_current.load(std::memory_order_acquire);
+    if (producer.backend.get() != backend) { // First record since the backend changed
+        producer.ring.reset();
+        producer.backend.reset();
+
+        std::lock_guard<std::mutex> lock(async_mutex);
+        backend = async.get(); // May be newer than what was loaded above
+        if (backend) {
+            producer.backend = async;
+            producer.ring = std::make_shared<Spsc_ring<char>>(backend->ring_size);
+
+            std::lock_guard<std::mutex> rings_lock(backend->rings_mutex);
+            backend->rings.push_back(producer.ring);
+        }
     }
-}
\ No newline at end of file
+    if (!backend || size > backend->ring_size) { // Records that can never fit are written directly
+        write_out(data, size);
+        return;
+    }
+    while (!producer.ring->try_push(data, size)) {
+        if (backend->policy != Overflow_policy::Block) {
+            backend->n_dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        if (async_current.load(std::memory_order_acquire) != backend) { // Being disabled, nobody will make room
+            return;
+        }
+        std::this_thread::yield();
+    }
+    // Pairs with the writer setting writer_idle before it checks the buffers one last time
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (backend->writer_idle.load(std::memory_order_relaxed)) {
+        backend->wake_writer();
+    }
+}
+
+size_t Logger::n_dropped() const
+{
+    std::lock_guard<std::mutex> lock(async_mutex);
+    return async ? async->n_dropped.load(std::memory_order_relaxed) : 0;
+}
+
+// Binary records _______________________________________________________________________________
+
+void Logger::append_record_header(std::vector<char>& out, Record_kind kind, uint32_t id, uint32_t payload_size)
+{
+    serialize_append(out, kind);
+    serialize_append(out, id);
+    serialize_append(out, payload_size);
+}
+
+Serialized& Logger::record_buffer()
+{
+    return producer.record;
+}
+
+uint32_t Logger::register_format(const char* format_str, const char* file, uint32_t line, 
+                                 std::vector<Arg_type> arg_types, Log_level level, uint8_t category)
+{
+    std::lock_guard<std::mutex> lock(formats_mutex);
+    formats.push_back(std::make_unique<Format_info>(Format_info{format_str, file, line, std::move(arg_types), 
+                                                                level, category_names[clamp_category(category)]}));
+    return formats.size();
+}
+
+void Logger::append_definitions(std::vector<char>& out)
+{
+    std::lock_guard<std::mutex> lock(formats_mutex);
+
+    for (; n_definitions_written < formats.size(); n_definitions_written++) {
+        const Format_info& info = *formats[n_definitions_written];
+        Serialized payload;
+        serialize_append(payload, info.line);
+        serialize_append(payload, info.level);
+        serialize_append(payload, static_cast<uint16_t>(info.arg_types.size()));
+        for (Arg_type type : info.arg_types) {
+            serialize_append(payload, type);
+        }
+        for (const std::string* str : {&info.format, &info.file, &info.category}) {
+            serialize_append(payload, static_cast<uint16_t>(str->size()));
+            payload.insert(payload.end(), str->begin(), str->end());
+        }
+        append_record_header(out, Record_kind::Definition, n_definitions_written + 1, payload.size());
+        out.insert(out.end(), payload.begin(), payload.end());
+    }
+}
+
+/// @brief Reads a value from a record payload, advancing pos.
+template <typename Type>
+static bool read_value(const char* data, size_t size, size_t& pos, Type& value)
+{
+    if (size - pos < sizeof(Type) || pos > size) {
+        return false;
+    }
+    std::memcpy(&value, data + pos, sizeof(Type));
+    pos += sizeof(Type);
+    return true;
+}
+
+/// @brief Reads a record payload of size bytes. The buffer grows only as data arrives,
+///        so a corrupt size can't allocate more than the stream actually holds.
+static bool read_payload(std::istream& binary, std::vector<char>& payload, uint32_t size)
+{
+    payload.clear();
+    while (payload.size() < size) {
+        size_t old_size = payload.size();
+        size_t chunk = std::min<size_t>(size - old_size, 1 << 16);
+        payload.resize(old_size + chunk);
+        if (!binary.read(payload.data() + old_size, chunk)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// @brief Renders arguments of a data record according to its format.
+/// @return Whether payload matched the format.
+static bool render(const Logger::Format_info& info, const char* payload, size_t size, std::ostream& out)
+{
+    size_t pos = 0;
+    size_t format_pos = 0;
+
+    write_prefix(out, info.level, info.category);
+    for (Logger::Arg_type type : info.arg_types) {
+        size_t placeholder = info.format.find("{}", format_pos);
+        out.write(info.format.data() + format_pos, 
+                  (placeholder == std::string::npos ? info.format.size() : placeholder) - format_pos);
+        format_pos = placeholder == std::string::npos ? info.format.size() : placeholder + 2;
+        if (placeholder == std::string::npos) { // More arguments than placeholders -- append them
+            out << ' ';
+        }
+        bool ok = true;
+        switch (type) {
+            case Logger::Arg_type::Bool: { bool v{}; ok = read_value(payload, size, pos, v); out << v; break; }
+            case Logger::Arg_type::Char: { char v{}; ok = read_value(payload, size, pos, v); out << v; break; }
+            case Logger::Arg_type::I8:  { int8_t v{};   ok = read_value(payload, size, pos, v); out << int(v); break; }
+            case Logger::Arg_type::U8:  { uint8_t v{};  ok = read_value(payload, size, pos, v); out << unsigned(v); break; }
+            case Logger::Arg_type::I16: { int16_t v{};  ok = read_value(payload, size, pos, v); out << v; break; }
+            case Logger::Arg_type::U16: { uint16_t v{}; ok = read_value(payload, size, pos, v); out << v; break; }
+            case Logger::Arg_type::I32: { int32_t v{};  ok = read_value(payload, size, pos, v); out << v; break; }
+            case Logger::Arg_type::U32: { uint32_t v{}; ok = read_value(payload, size, pos, v); out << v; break; }
+            case Logger::Arg_type::I64: { int64_t v{};  ok = read_value(payload, size, pos, v); out << v; break; }
+            case Logger::Arg_type::U64: { uint64_t v{}; ok = read_value(payload, size, pos, v); out << v; break; }
+            case Logger::Arg_type::F32: { float v{};    ok = read_value(payload, size, pos, v); out << v; break; }
+            case Logger::Arg_type::F64: { double v{};   ok = read_value(payload, size, pos, v); out << v; break; }
+            case Logger::Arg_type::Pointer: { 
+                uint64_t v{};
+                ok = read_value(payload, size, pos, v); 
+                out << "0x" << std::hex << v << std::dec; 
+                break; 
+            }
+            case Logger::Arg_type::String:
+            case Logger::Arg_type::Raw: {
+                uint16_t length;
+                ok = read_value(payload, size, pos, length) && size - pos >= length;
+                if (!ok) {
+                    break;
+                }
+                if (type == Logger::Arg_type::String) {
+                    out.write(payload + pos, length);
+                }
+                else {
+                    static const char digits[] = "0123456789abcdef";
+                    out << '<';
+                    for (uint16_t i = 0; i < length; i++) {
+                        unsigned char byte = payload[pos + i];
+                        out << digits[byte >> 4] << digits[byte & 0xf];
+                    }
+                    out << '>';
+                }
+                pos += length;
+                break;
+            }
+            default:
+                ok = false;
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    out.write(info.format.data() + format_pos, info.format.size() - format_pos);
+    out << '\n';
+    return pos == size;
+}
+
+void Logger::submit_record(const Serialized& record)
+{
+    if (format == Format::Binary) {
+        submit(record.data(), record.size());
+        return;
+    }
+    // Text mode: render right away
+    uint32_t id;
+    std::memcpy(&id, record.data() + sizeof(Record_kind), sizeof(id));
+    const Format_info* info;
+    {
+        std::lock_guard<std::mutex> lock(formats_mutex);
+        info = formats[id - 1].get();
+    }
+    // Render after whatever operator<< has buffered so far, and leave that part in place
+    std::string& line = producer.buffer.line;
+    size_t pending = line.size();
+    render(*info, record.data() + record_header_size, record.size() - record_header_size, producer.stream);
+    record_crash_line(line.data() + pending, line.size() - pending);
+    submit(line.data() + pending, line.size() - pending);
+    line.resize(pending);
+}
+
+bool Logger::decode(std::istream& binary, std::ostream& text)
+{
+    char magic[sizeof(binary_magic)];
+    if (!binary.read(magic, sizeof(magic)) || std::memcmp(magic, binary_magic, sizeof(magic)) != 0) {
+        return false;
+    }
+    std::unordered_map<uint32_t, Format_info> definitions;
+    std::vector<char> payload;
+
+    while (true) {
+        Record_kind kind;
+        uint32_t id, size;
+        if (!binary.read(reinterpret_cast<char*>(&kind), sizeof(kind))) {
+            return binary.eof(); // Clean end of log
+        }
+        if (!binary.read(reinterpret_cast<char*>(&id), sizeof(id)) || 
+            !binary.read(reinterpret_cast<char*>(&size), sizeof(size))) {
+            return false;
+        }
+        if (!read_payload(binary, payload, size)) {
+            return false;
+        }
+        if (kind == Record_kind::Text) {
+            text.write(payload.data(), size);
+        }
+        else if (kind == Record_kind::Definition) {
+            Format_info info;
+            size_t pos = 0;
+            uint16_t n_args;
+            if (!read_value(payload.data(), size, pos, info.line) || !read_value(payload.data(), size, pos, info.level) ||
+                !read_value(payload.data(), size, pos, n_args)) {
+                return false;
+            }
+            if (static_cast<uint8_t>(info.level) > static_cast<uint8_t>(Log_level::Off)) {
+                return false;
+            }
+            info.arg_types.resize(n_args);
+            for (Arg_type& type : info.arg_types) {
+                if (!read_value(payload.data(), size, pos, type)) {
+                    return false;
+                }
+            }
+            for (std::string* str : {&info.format, &info.file, &info.category}) {
+                uint16_t length;
+                if (!read_value(payload.data(), size, pos, length) || size - pos < length) {
+                    return false;
+                }
+                str->assign(payload.data() + pos, length);
+                pos += length;
+            }
+            definitions[id] = std::move(info);
+        }
+        else if (kind == Record_kind::Data) {
+            auto found = definitions.find(id);
+            if (found == definitions.end() || !render(found->second, payload.data(), size, text)) {
+                return false;
+            }
+        }
+        else {
+            return false;
+        }
+    }
+}
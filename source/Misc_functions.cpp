@@ -1,5 +1,11 @@
 #include <sztronics/miscellaneous/Misc_functions.hpp>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
 /// @brief Split text into multiple lines with an optional upper bound on line width
 /// @param text The string to split
 /// @param line_width Maximum allowed line width. Set to 0 or negative to disable (handle only newlines)
@@ -78,4 +84,177 @@ std::vector<std::string> wrap_text(const std::string& text, int line_width)
     // lines.resize(new_line_count);
 
     return lines;
+}
+
+/// @return Position of the first space or newline in [begin, end), or end.
+static inline const char* find_delimiter(const char* begin, const char* end)
+{
+#if defined(__SSE2__)
+    const __m128i spaces = _mm_set1_epi8(' ');
+    const __m128i newlines = _mm_set1_epi8('\n');
+    for (; end - begin >= 16; begin += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, spaces), _mm_cmpeq_epi8(chunk, newlines)));
+        if (mask != 0) {
+            return begin + __builtin_ctz(mask);
+        }
+    }
+#elif defined(__aarch64__)
+    for (; end - begin >= 16; begin += 16) {
+        uint8x16_t chunk = vld1q_u8(reinterpret_cast<const uint8_t*>(begin));
+        uint8x16_t found = vorrq_u8(vceqq_u8(chunk, vdupq_n_u8(' ')), vceqq_u8(chunk, vdupq_n_u8('\n')));
+        if (vmaxvq_u8(found) != 0) {
+            break; // Locate it in the scalar loop below
+        }
+    }
+#endif
+    while (begin != end && *begin != ' ' && *begin != '\n') {
+        begin++;
+    }
+    return begin;
+}
+
+/// @brief Lines of wrap_text are always contiguous in the text, so only their bounds are tracked here.
+///        Every step mirrors the corresponding one in wrap_text.
+void wrap_text_views(std::string_view text, int32_t line_width, std::vector<std::string_view>& lines)
+{
+    lines.clear();
+    const size_t width = line_width > 0 ? line_width : 0;
+    size_t line_start = 0;
+    size_t line_end = 0;
+
+    auto end_line = [&]() {
+        size_t size = line_end - line_start;
+        while (size > 1 && text[line_start + size - 1] == ' ') { // Trim whitespaces at line ends
+            size--;
+        }
+        lines.push_back(text.substr(line_start, size));
+    };
+    // Same as the body of the first if in wrap_text
+    auto place_word = [&](size_t word_start, size_t word_end) {
+        if (width > 0 && line_end - line_start + word_end - word_start > width) {
+            while (word_end - word_start > width) { // If word is too big, handle its parts
+                if (line_end != line_start) {
+                    end_line();
+                }
+                line_start = word_start;
+                line_end = word_start + width;
+                word_start += width;
+                if (word_end - word_start > width) {
+                    end_line();
+                    line_start = line_end = word_start;
+                }
+            }
+            end_line();
+            line_start = word_start;
+            line_end = word_end;
+        }
+        else if (word_end != word_start) {
+            line_end = word_end;
+        }
+    };
+
+    const char* data = text.data();
+    size_t word_start = 0;
+    while (true) {
+        size_t word_end = find_delimiter(data + word_start, data + text.size()) - data;
+        place_word(word_start, word_end);
+        if (word_end == text.size()) {
+            break;
+        }
+        if (text[word_end] == ' ') {
+            if (width == 0 || line_end - line_start < width) {
+                line_end = word_end + 1;
+            }
+        }
+        else { // Force end line
+            end_line();
+            line_start = line_end = word_end + 1;
+        }
+        word_start = word_end + 1;
+    }
+    end_line();
+}
+
+/// @brief Shared body of find_equal: compares 16 bytes of lanes at a time.
+template <typename Lane>
+static inline size_t find_equal_lanes(const Lane* data, size_t size, Lane key)
+{
+    size_t index = 0;
+#if defined(__SSE2__)
+    constexpr size_t lanes_per_chunk = 16 / sizeof(Lane);
+    __m128i keys;
+    if constexpr (sizeof(Lane) == 1) { keys = _mm_set1_epi8(key); }
+    else if constexpr (sizeof(Lane) == 2) { keys = _mm_set1_epi16(key); }
+    else if constexpr (sizeof(Lane) == 4) { keys = _mm_set1_epi32(key); }
+    else { keys = _mm_set1_epi64x(key); }
+
+    for (; index + lanes_per_chunk <= size; index += lanes_per_chunk) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + index));
+        __m128i equal;
+        if constexpr (sizeof(Lane) == 1) { equal = _mm_cmpeq_epi8(chunk, keys); }
+        else if constexpr (sizeof(Lane) == 2) { equal = _mm_cmpeq_epi16(chunk, keys); }
+        else if constexpr (sizeof(Lane) == 4) { equal = _mm_cmpeq_epi32(chunk, keys); }
+        else { // No 64-bit compare in SSE2: both 32-bit halves must match
+            equal = _mm_cmpeq_epi32(chunk, keys);
+            equal = _mm_and_si128(equal, _mm_shuffle_epi32(equal, _MM_SHUFFLE(2, 3, 0, 1)));
+        }
+        int mask = _mm_movemask_epi8(equal);
+        if (mask != 0) {
+            return index + __builtin_ctz(mask) / sizeof(Lane);
+        }
+    }
+#endif
+    for (; index < size; index++) {
+        if (data[index] == key) {
+            break;
+        }
+    }
+    return index;
+}
+
+size_t find_equal(const uint8_t* data, size_t size, uint8_t key) { return find_equal_lanes(data, size, key); }
+size_t find_equal(const uint16_t* data, size_t size, uint16_t key) { return find_equal_lanes(data, size, key); }
+size_t find_equal(const uint32_t* data, size_t size, uint32_t key) { return find_equal_lanes(data, size, key); }
+size_t find_equal(const uint64_t* data, size_t size, uint64_t key) { return find_equal_lanes(data, size, key); }
+
+#if defined(__SSE2__)
+/// @return Mask of bytes in [low, high]. Only for ranges within 0x00-0x7F, as bytes compare signed.
+static inline __m128i bytes_in_range(__m128i chunk, char low, char high)
+{
+    return _mm_and_si128(_mm_cmpgt_epi8(chunk, _mm_set1_epi8(low - 1)), _mm_cmplt_epi8(chunk, _mm_set1_epi8(high + 1)));
+}
+#endif
+
+size_t word_prefix_length(std::string_view text)
+{
+    size_t length = 0;
+#if defined(__SSE2__)
+    for (; length + 16 <= text.size(); length += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + length));
+        __m128i folded = _mm_or_si128(chunk, _mm_set1_epi8(0x20)); // Upper case to lower case
+        __m128i word = _mm_or_si128(_mm_or_si128(bytes_in_range(folded, 'a', 'z'), bytes_in_range(chunk, '0', '9')),
+                                    _mm_cmpeq_epi8(chunk, _mm_set1_epi8('_')));
+        int mask = ~_mm_movemask_epi8(word) & 0xFFFF;
+        if (mask != 0) {
+            return length + __builtin_ctz(mask);
+        }
+    }
+#endif
+    return length + char_class_prefix_length(text.substr(length), Char_class::Word);
+}
+
+size_t find_non_printable(std::string_view text)
+{
+    size_t pos = 0;
+#if defined(__SSE2__)
+    for (; pos + 16 <= text.size(); pos += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + pos));
+        int mask = ~_mm_movemask_epi8(bytes_in_range(chunk, ' ', '~')) & 0xFFFF;
+        if (mask != 0) {
+            return pos + __builtin_ctz(mask);
+        }
+    }
+#endif
+    return pos + char_class_prefix_length(text.substr(pos), Char_class::Printable);
 }
\ No newline at end of file
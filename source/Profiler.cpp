@@ -0,0 +1,219 @@
+#include <sztronics/miscellaneous/Profiler.hpp>
+#include <sztronics/miscellaneous/Spsc_ring.hpp>
+
+#include <memory>
+#include <mutex>
+#include <algorithm>
+#include <fstream>
+
+/// @brief One completed zone on one thread.
+struct Profile_event
+{
+    uint64_t start_ns;
+    uint64_t end_ns;
+    uint32_t zone_id;
+};
+
+/// @brief Event buffer of one thread, shared with the collector.
+struct Trace_buffer
+{
+    Spsc_ring<Profile_event> ring{PROFILER_RING_SIZE};
+    uint32_t thread_id;
+};
+
+/// @brief Event moved out of a Trace_buffer.
+struct Collected_event
+{
+    Profile_event event;
+    uint32_t thread_id;
+};
+
+std::atomic<bool> Profiler::active = false;
+std::atomic<bool> Profiler::tracing = false;
+
+static std::mutex zones_mutex;
+static std::vector<Profile_zone_info*> zones;
+
+// Buffers are registered on a thread's first event; collecting is serialized by buffers_mutex
+static std::mutex buffers_mutex;
+static std::vector<std::shared_ptr<Trace_buffer>> buffers;
+static std::vector<Collected_event> collected;
+static std::atomic<uint32_t> thread_counter = 0;
+static std::atomic<size_t> dropped = 0;
+
+static thread_local std::shared_ptr<Trace_buffer> thread_buffer;
+
+Profile_zone_info::Profile_zone_info(const char* name, const char* file, uint32_t line) :
+    name(name), file(file), line(line)
+{
+    std::lock_guard<std::mutex> lock(zones_mutex);
+    id = zones.size();
+    zones.push_back(this);
+}
+
+void Profiler::enable(bool tracing)
+{
+    Profiler::tracing.store(tracing, std::memory_order_relaxed);
+    active.store(true, std::memory_order_relaxed);
+}
+
+void Profiler::disable()
+{
+    active.store(false, std::memory_order_relaxed);
+    tracing.store(false, std::memory_order_relaxed);
+}
+
+/// @return Histogram bucket of a duration: its bit width.
+static inline size_t histogram_bucket(uint64_t duration_ns)
+{
+    return duration_ns == 0 ? 0 : 64 - __builtin_clzll(duration_ns);
+}
+
+void Profiler::record(Profile_zone_info& zone, uint64_t start_ns, uint64_t end_ns)
+{
+    uint64_t duration = end_ns - start_ns;
+
+    zone.n_calls.fetch_add(1, std::memory_order_relaxed);
+    zone.total_ns.fetch_add(duration, std::memory_order_relaxed);
+    zone.histogram[std::min<size_t>(histogram_bucket(duration), PROFILER_HISTOGRAM_BUCKETS - 1)]
+        .fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t max = zone.max_ns.load(std::memory_order_relaxed);
+    while (duration > max && !zone.max_ns.compare_exchange_weak(max, duration, std::memory_order_relaxed));
+
+    if (!tracing.load(std::memory_order_relaxed)) {
+        return;
+    }
+    if (!thread_buffer) {
+        thread_buffer = std::make_shared<Trace_buffer>();
+        thread_buffer->thread_id = ++thread_counter;
+
+        std::lock_guard<std::mutex> lock(buffers_mutex);
+        buffers.push_back(thread_buffer);
+    }
+    if (!thread_buffer->ring.try_push(Profile_event{start_ns, end_ns, zone.id})) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+std::vector<Profiler::Zone_stats> Profiler::stats()
+{
+    std::lock_guard<std::mutex> lock(zones_mutex);
+    std::vector<Zone_stats> result;
+
+    for (Profile_zone_info* zone : zones) {
+        uint64_t n_calls = zone->n_calls.load(std::memory_order_relaxed);
+        if (n_calls == 0) {
+            continue;
+        }
+        Zone_stats stats{zone->name, zone->file, zone->line, n_calls,
+                         zone->total_ns.load(std::memory_order_relaxed),
+                         zone->max_ns.load(std::memory_order_relaxed), {}};
+        for (std::atomic<uint64_t>& bucket : zone->histogram) {
+            stats.histogram.push_back(bucket.load(std::memory_order_relaxed));
+        }
+        result.push_back(std::move(stats));
+    }
+    return result;
+}
+
+/// @brief Drains every thread buffer into collected. Expects buffers_mutex to be held.
+static void drain_buffers()
+{
+    for (std::shared_ptr<Trace_buffer>& buffer : buffers) {
+        Profile_event event;
+        while (buffer->ring.try_pop(event)) {
+            collected.push_back({event, buffer->thread_id});
+        }
+    }
+    // Forget buffers of exited threads
+    buffers.erase(std::remove_if(buffers.begin(), buffers.end(),
+                  [](const std::shared_ptr<Trace_buffer>& buffer) { return buffer.use_count() == 1; }),
+                  buffers.end());
+}
+
+void Profiler::reset()
+{
+    {
+        std::lock_guard<std::mutex> lock(zones_mutex);
+        for (Profile_zone_info* zone : zones) {
+            zone->n_calls.store(0, std::memory_order_relaxed);
+            zone->total_ns.store(0, std::memory_order_relaxed);
+            zone->max_ns.store(0, std::memory_order_relaxed);
+            for (std::atomic<uint64_t>& bucket : zone->histogram) {
+                bucket.store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    drain_buffers();
+    collected.clear();
+    dropped.store(0, std::memory_order_relaxed);
+}
+
+size_t Profiler::collect()
+{
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    drain_buffers();
+    return collected.size();
+}
+
+size_t Profiler::n_dropped()
+{
+    return dropped.load(std::memory_order_relaxed);
+}
+
+/// @brief Writes str as a JSON string literal.
+static void write_json_string(std::ostream& out, const char* str)
+{
+    out << '"';
+    static const char hex_digits[] = "0123456789abcdef";
+    for (; *str; str++) {
+        unsigned char ch = *str;
+        if (ch < 0x20) { // Control characters are not allowed raw in JSON strings
+            out << "\\u00" << hex_digits[ch >> 4] << hex_digits[ch & 0xf];
+            continue;
+        }
+        if (ch == '"' || ch == '\\') {
+            out << '\\';
+        }
+        out << *str;
+    }
+    out << '"';
+}
+
+bool Profiler::export_chrome_trace(const std::string& filename)
+{
+    std::ofstream out(filename);
+    if (!out) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    drain_buffers();
+
+    // Copied after draining, so every collected event's zone is already registered
+    std::vector<Profile_zone_info*> zones_copy;
+    {
+        std::lock_guard<std::mutex> zones_lock(zones_mutex);
+        zones_copy = zones;
+    }
+
+    // Complete ("X") events; timestamps are in microseconds
+    out << "{\"traceEvents\":[";
+    out.precision(3);
+    out << std::fixed;
+    for (size_t i = 0; i < collected.size(); i++) {
+        const Collected_event& collected_event = collected[i];
+        const Profile_zone_info& zone = *zones_copy[collected_event.event.zone_id];
+
+        out << (i == 0 ? "\n" : ",\n") << "{\"name\":";
+        write_json_string(out, zone.name);
+        out << ",\"cat\":";
+        write_json_string(out, zone.file);
+        out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << collected_event.thread_id
+            << ",\"ts\":" << collected_event.event.start_ns / 1000.0
+            << ",\"dur\":" << (collected_event.event.end_ns - collected_event.event.start_ns) / 1000.0 << '}';
+    }
+    out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+    return out.good();
+}
@@ -0,0 +1,525 @@
+#include <sztronics/miscellaneous/Text_layout.hpp>
+
+#include <array>
+#include <algorithm>
+
+// Width table ____________________________________________________________________________________
+
+struct Width_range
+{
+    uint32_t first;
+    uint32_t last;
+};
+
+// Ranges follow the Unicode 15.0 data used by glibc's wcwidth(); codepoints outside them take 1 column.
+// Zero width: combining marks, format characters, Hangul medial and final jamo.
+static constexpr Width_range zero_width_ranges[] = {
+    {0x0300, 0x036F}, {0x0483, 0x0489}, {0x0591, 0x05BD}, {0x05BF, 0x05BF}, {0x05C1, 0x05C2},
+    {0x05C4, 0x05C5}, {0x05C7, 0x05C7}, {0x0610, 0x061A}, {0x061C, 0x061C}, {0x064B, 0x065F},
+    {0x0670, 0x0670}, {0x06D6, 0x06DC}, {0x06DF, 0x06E4}, {0x06E7, 0x06E8}, {0x06EA, 0x06ED},
+    {0x0711, 0x0711}, {0x0730, 0x074A}, {0x07A6, 0x07B0}, {0x07EB, 0x07F3}, {0x07FD, 0x07FD},
+    {0x0816, 0x0819}, {0x081B, 0x0823}, {0x0825, 0x0827}, {0x0829, 0x082D}, {0x0859, 0x085B},
+    {0x0898, 0x089F}, {0x08CA, 0x08E1}, {0x08E3, 0x0902}, {0x093A, 0x093A}, {0x093C, 0x093C},
+    {0x0941, 0x0948}, {0x094D, 0x094D}, {0x0951, 0x0957}, {0x0962, 0x0963}, {0x0981, 0x0981},
+    {0x09BC, 0x09BC}, {0x09C1, 0x09C4}, {0x09CD, 0x09CD}, {0x09E2, 0x09E3}, {0x09FE, 0x09FE},
+    {0x0A01, 0x0A02}, {0x0A3C, 0x0A3C}, {0x0A41, 0x0A42}, {0x0A47, 0x0A48}, {0x0A4B, 0x0A4D},
+    {0x0A51, 0x0A51}, {0x0A70, 0x0A71}, {0x0A75, 0x0A75}, {0x0A81, 0x0A82}, {0x0ABC, 0x0ABC},
+    {0x0AC1, 0x0AC5}, {0x0AC7, 0x0AC8}, {0x0ACD, 0x0ACD}, {0x0AE2, 0x0AE3}, {0x0AFA, 0x0AFF},
+    {0x0B01, 0x0B01}, {0x0B3C, 0x0B3C}, {0x0B3F, 0x0B3F}, {0x0B41, 0x0B44}, {0x0B4D, 0x0B4D},
+    {0x0B55, 0x0B56}, {0x0B62, 0x0B63}, {0x0B82, 0x0B82}, {0x0BC0, 0x0BC0}, {0x0BCD, 0x0BCD},
+    {0x0C00, 0x0C00}, {0x0C04, 0x0C04}, {0x0C3C, 0x0C3C}, {0x0C3E, 0x0C40}, {0x0C46, 0x0C48},
+    {0x0C4A, 0x0C4D}, {0x0C55, 0x0C56}, {0x0C62, 0x0C63}, {0x0C81, 0x0C81}, {0x0CBC, 0x0CBC},
+    {0x0CBF, 0x0CBF}, {0x0CC6, 0x0CC6}, {0x0CCC, 0x0CCD}, {0x0CE2, 0x0CE3}, {0x0D00, 0x0D01},
+    {0x0D3B, 0x0D3C}, {0x0D41, 0x0D44}, {0x0D4D, 0x0D4D}, {0x0D62, 0x0D63}, {0x0D81, 0x0D81},
+    {0x0DCA, 0x0DCA}, {0x0DD2, 0x0DD4}, {0x0DD6, 0x0DD6}, {0x0E31, 0x0E31}, {0x0E34, 0x0E3A},
+    {0x0E47, 0x0E4E}, {0x0EB1, 0x0EB1}, {0x0EB4, 0x0EBC}, {0x0EC8, 0x0ECD}, {0x0F18, 0x0F19},
+    {0x0F35, 0x0F35}, {0x0F37, 0x0F37}, {0x0F39, 0x0F39}, {0x0F71, 0x0F7E}, {0x0F80, 0x0F84},
+    {0x0F86, 0x0F87}, {0x0F8D, 0x0F97}, {0x0F99, 0x0FBC}, {0x0FC6, 0x0FC6}, {0x102D, 0x1030},
+    {0x1032, 0x1037}, {0x1039, 0x103A}, {0x103D, 0x103E}, {0x1058, 0x1059}, {0x105E, 0x1060},
+    {0x1071, 0x1074}, {0x1082, 0x1082}, {0x1085, 0x1086}, {0x108D, 0x108D}, {0x109D, 0x109D},
+    {0x1160, 0x11FF}, {0x135D, 0x135F}, {0x1712, 0x1714}, {0x1732, 0x1733}, {0x1752, 0x1753},
+    {0x1772, 0x1773}, {0x17B4, 0x17B5}, {0x17B7, 0x17BD}, {0x17C6, 0x17C6}, {0x17C9, 0x17D3},
+    {0x17DD, 0x17DD}, {0x180B, 0x180F}, {0x1885, 0x1886}, {0x18A9, 0x18A9}, {0x1920, 0x1922},
+    {0x1927, 0x1928}, {0x1932, 0x1932}, {0x1939, 0x193B}, {0x1A17, 0x1A18}, {0x1A1B, 0x1A1B},
+    {0x1A56, 0x1A56}, {0x1A58, 0x1A5E}, {0x1A60, 0x1A60}, {0x1A62, 0x1A62}, {0x1A65, 0x1A6C},
+    {0x1A73, 0x1A7C}, {0x1A7F, 0x1A7F}, {0x1AB0, 0x1ACE}, {0x1B00, 0x1B03}, {0x1B34, 0x1B34},
+    {0x1B36, 0x1B3A}, {0x1B3C, 0x1B3C}, {0x1B42, 0x1B42}, {0x1B6B, 0x1B73}, {0x1B80, 0x1B81},
+    {0x1BA2, 0x1BA5}, {0x1BA8, 0x1BA9}, {0x1BAB, 0x1BAD}, {0x1BE6, 0x1BE6}, {0x1BE8, 0x1BE9},
+    {0x1BED, 0x1BED}, {0x1BEF, 0x1BF1}, {0x1C2C, 0x1C33}, {0x1C36, 0x1C37}, {0x1CD0, 0x1CD2},
+    {0x1CD4, 0x1CE0}, {0x1CE2, 0x1CE8}, {0x1CED, 0x1CED}, {0x1CF4, 0x1CF4}, {0x1CF8, 0x1CF9},
+    {0x1DC0, 0x1DFF}, {0x200B, 0x200F}, {0x202A, 0x202E}, {0x2060, 0x2064}, {0x2066, 0x206F},
+    {0x20D0, 0x20F0}, {0x2CEF, 0x2CF1}, {0x2D7F, 0x2D7F}, {0x2DE0, 0x2DFF}, {0x302A, 0x302D},
+    {0x3099, 0x309A}, {0xA66F, 0xA672}, {0xA674, 0xA67D}, {0xA69E, 0xA69F}, {0xA6F0, 0xA6F1},
+    {0xA802, 0xA802}, {0xA806, 0xA806}, {0xA80B, 0xA80B}, {0xA825, 0xA826}, {0xA82C, 0xA82C},
+    {0xA8C4, 0xA8C5}, {0xA8E0, 0xA8F1}, {0xA8FF, 0xA8FF}, {0xA926, 0xA92D}, {0xA947, 0xA951},
+    {0xA980, 0xA982}, {0xA9B3, 0xA9B3}, {0xA9B6, 0xA9B9}, {0xA9BC, 0xA9BD}, {0xA9E5, 0xA9E5},
+    {0xAA29, 0xAA2E}, {0xAA31, 0xAA32}, {0xAA35, 0xAA36}, {0xAA43, 0xAA43}, {0xAA4C, 0xAA4C},
+    {0xAA7C, 0xAA7C}, {0xAAB0, 0xAAB0}, {0xAAB2, 0xAAB4}, {0xAAB7, 0xAAB8}, {0xAABE, 0xAABF},
+    {0xAAC1, 0xAAC1}, {0xAAEC, 0xAAED}, {0xAAF6, 0xAAF6}, {0xABE5, 0xABE5}, {0xABE8, 0xABE8},
+    {0xABED, 0xABED}, {0xD7B0, 0xD7C6}, {0xD7CB, 0xD7FB}, {0xFB1E, 0xFB1E}, {0xFE00, 0xFE0F},
+    {0xFE20, 0xFE2F}, {0xFEFF, 0xFEFF}, {0xFFF9, 0xFFFB}, {0x101FD, 0x101FD}, {0x102E0, 0x102E0},
+    {0x10376, 0x1037A}, {0x10A01, 0x10A03}, {0x10A05, 0x10A06}, {0x10A0C, 0x10A0F}, {0x10A38, 0x10A3A},
+    {0x10A3F, 0x10A3F}, {0x10AE5, 0x10AE6}, {0x10D24, 0x10D27}, {0x10EAB, 0x10EAC}, {0x10F46, 0x10F50},
+    {0x10F82, 0x10F85}, {0x11001, 0x11001}, {0x11038, 0x11046}, {0x11070, 0x11070}, {0x11073, 0x11074},
+    {0x1107F, 0x11081}, {0x110B3, 0x110B6}, {0x110B9, 0x110BA}, {0x110C2, 0x110C2}, {0x11100, 0x11102},
+    {0x11127, 0x1112B}, {0x1112D, 0x11134}, {0x11173, 0x11173}, {0x11180, 0x11181}, {0x111B6, 0x111BE},
+    {0x111C9, 0x111CC}, {0x111CF, 0x111CF}, {0x1122F, 0x11231}, {0x11234, 0x11234}, {0x11236, 0x11237},
+    {0x1123E, 0x1123E}, {0x112DF, 0x112DF}, {0x112E3, 0x112EA}, {0x11300, 0x11301}, {0x1133B, 0x1133C},
+    {0x11340, 0x11340}, {0x11366, 0x1136C}, {0x11370, 0x11374}, {0x11438, 0x1143F}, {0x11442, 0x11444},
+    {0x11446, 0x11446}, {0x1145E, 0x1145E}, {0x114B3, 0x114B8}, {0x114BA, 0x114BA}, {0x114BF, 0x114C0},
+    {0x114C2, 0x114C3}, {0x115B2, 0x115B5}, {0x115BC, 0x115BD}, {0x115BF, 0x115C0}, {0x115DC, 0x115DD},
+    {0x11633, 0x1163A}, {0x1163D, 0x1163D}, {0x1163F, 0x11640}, {0x116AB, 0x116AB}, {0x116AD, 0x116AD},
+    {0x116B0, 0x116B5}, {0x116B7, 0x116B7}, {0x1171D, 0x1171F}, {0x11722, 0x11725}, {0x11727, 0x1172B},
+    {0x1182F, 0x11837}, {0x11839, 0x1183A}, {0x1193B, 0x1193C}, {0x1193E, 0x1193E}, {0x11943, 0x11943},
+    {0x119D4, 0x119D7}, {0x119DA, 0x119DB}, {0x119E0, 0x119E0}, {0x11A01, 0x11A0A}, {0x11A33, 0x11A38},
+    {0x11A3B, 0x11A3E}, {0x11A47, 0x11A47}, {0x11A51, 0x11A56}, {0x11A59, 0x11A5B}, {0x11A8A, 0x11A96},
+    {0x11A98, 0x11A99}, {0x11C30, 0x11C36}, {0x11C38, 0x11C3D}, {0x11C3F, 0x11C3F}, {0x11C92, 0x11CA7},
+    {0x11CAA, 0x11CB0}, {0x11CB2, 0x11CB3}, {0x11CB5, 0x11CB6}, {0x11D31, 0x11D36}, {0x11D3A, 0x11D3A},
+    {0x11D3C, 0x11D3D}, {0x11D3F, 0x11D45}, {0x11D47, 0x11D47}, {0x11D90, 0x11D91}, {0x11D95, 0x11D95},
+    {0x11D97, 0x11D97}, {0x11EF3, 0x11EF4}, {0x13430, 0x13438}, {0x16AF0, 0x16AF4}, {0x16B30, 0x16B36},
+    {0x16F4F, 0x16F4F}, {0x16F8F, 0x16F92}, {0x16FE4, 0x16FE4}, {0x1BC9D, 0x1BC9E}, {0x1BCA0, 0x1BCA3},
+    {0x1CF00, 0x1CF2D}, {0x1CF30, 0x1CF46}, {0x1D167, 0x1D169}, {0x1D173, 0x1D182}, {0x1D185, 0x1D18B},
+    {0x1D1AA, 0x1D1AD}, {0x1D242, 0x1D244}, {0x1DA00, 0x1DA36}, {0x1DA3B, 0x1DA6C}, {0x1DA75, 0x1DA75},
+    {0x1DA84, 0x1DA84}, {0x1DA9B, 0x1DA9F}, {0x1DAA1, 0x1DAAF}, {0x1E000, 0x1E006}, {0x1E008, 0x1E018},
+    {0x1E01B, 0x1E021}, {0x1E023, 0x1E024}, {0x1E026, 0x1E02A}, {0x1E130, 0x1E136}, {0x1E2AE, 0x1E2AE},
+    {0x1E2EC, 0x1E2EF}, {0x1E8D0, 0x1E8D6}, {0x1E944, 0x1E94A},
+};
+
+// Wide: East Asian Wide and Fullwidth characters, emoji presentation.
+static constexpr Width_range wide_ranges[] = {
+    {0x1100, 0x115F}, {0x231A, 0x231B}, {0x2329, 0x232A}, {0x23E9, 0x23EC}, {0x23F0, 0x23F0},
+    {0x23F3, 0x23F3}, {0x25FD, 0x25FE}, {0x2614, 0x2615}, {0x2648, 0x2653}, {0x267F, 0x267F},
+    {0x2693, 0x2693}, {0x26A1, 0x26A1}, {0x26AA, 0x26AB}, {0x26BD, 0x26BE}, {0x26C4, 0x26C5},
+    {0x26CE, 0x26CE}, {0x26D4, 0x26D4}, {0x26EA, 0x26EA}, {0x26F2, 0x26F3}, {0x26F5, 0x26F5},
+    {0x26FA, 0x26FA}, {0x26FD, 0x26FD}, {0x2705, 0x2705}, {0x270A, 0x270B}, {0x2728, 0x2728},
+    {0x274C, 0x274C}, {0x274E, 0x274E}, {0x2753, 0x2755}, {0x2757, 0x2757}, {0x2795, 0x2797},
+    {0x27B0, 0x27B0}, {0x27BF, 0x27BF}, {0x2B1B, 0x2B1C}, {0x2B50, 0x2B50}, {0x2B55, 0x2B55},
+    {0x2E80, 0x2E99}, {0x2E9B, 0x2EF3}, {0x2F00, 0x2FD5}, {0x2FF0, 0x2FFB}, {0x3000, 0x3029},
+    {0x302E, 0x303E}, {0x3041, 0x3096}, {0x309B, 0x30FF}, {0x3105, 0x312F}, {0x3131, 0x318E},
+    {0x3190, 0x31E3}, {0x31F0, 0x321E}, {0x3220, 0xA48C}, {0xA490, 0xA4C6}, {0xA960, 0xA97C},
+    {0xAC00, 0xD7A3}, {0xF900, 0xFA6D}, {0xFA70, 0xFAD9}, {0xFE10, 0xFE19}, {0xFE30, 0xFE52},
+    {0xFE54, 0xFE66}, {0xFE68, 0xFE6B}, {0xFF01, 0xFF60}, {0xFFE0, 0xFFE6}, {0x16FE0, 0x16FE3},
+    {0x16FF0, 0x16FF1}, {0x17000, 0x187F7}, {0x18800, 0x18CD5}, {0x18D00, 0x18D08}, {0x1AFF0, 0x1AFF3},
+    {0x1AFF5, 0x1AFFB}, {0x1AFFD, 0x1AFFE}, {0x1B000, 0x1B122}, {0x1B150, 0x1B152}, {0x1B164, 0x1B167},
+    {0x1B170, 0x1B2FB}, {0x1F004, 0x1F004}, {0x1F0CF, 0x1F0CF}, {0x1F18E, 0x1F18E}, {0x1F191, 0x1F19A},
+    {0x1F200, 0x1F202}, {0x1F210, 0x1F23B}, {0x1F240, 0x1F248}, {0x1F250, 0x1F251}, {0x1F260, 0x1F265},
+    {0x1F300, 0x1F320}, {0x1F32D, 0x1F335}, {0x1F337, 0x1F37C}, {0x1F37E, 0x1F393}, {0x1F3A0, 0x1F3CA},
+    {0x1F3CF, 0x1F3D3}, {0x1F3E0, 0x1F3F0}, {0x1F3F4, 0x1F3F4}, {0x1F3F8, 0x1F43E}, {0x1F440, 0x1F440},
+    {0x1F442, 0x1F4FC}, {0x1F4FF, 0x1F53D}, {0x1F54B, 0x1F54E}, {0x1F550, 0x1F567}, {0x1F57A, 0x1F57A},
+    {0x1F595, 0x1F596}, {0x1F5A4, 0x1F5A4}, {0x1F5FB, 0x1F64F}, {0x1F680, 0x1F6C5}, {0x1F6CC, 0x1F6CC},
+    {0x1F6D0, 0x1F6D2}, {0x1F6D5, 0x1F6D7}, {0x1F6DD, 0x1F6DF}, {0x1F6EB, 0x1F6EC}, {0x1F6F4, 0x1F6FC},
+    {0x1F7E0, 0x1F7EB}, {0x1F7F0, 0x1F7F0}, {0x1F90C, 0x1F93A}, {0x1F93C, 0x1F945}, {0x1F947, 0x1F9FF},
+    {0x1FA70, 0x1FA74}, {0x1FA78, 0x1FA7C}, {0x1FA80, 0x1FA86}, {0x1FA90, 0x1FAAC}, {0x1FAB0, 0x1FABA},
+    {0x1FAC0, 0x1FAC5}, {0x1FAD0, 0x1FAD9}, {0x1FAE0, 0x1FAE7}, {0x1FAF0, 0x1FAF6}, {0x20000, 0x2A6DF},
+    {0x2A700, 0x2B738}, {0x2B740, 0x2B81D}, {0x2B820, 0x2CEA1}, {0x2CEB0, 0x2EBE0}, {0x2F800, 0x2FA1D},
+    {0x30000, 0x3134A},
+};
+
+// Two-level table for codepoints below width_table_limit: the first level maps each block
+// of 256 codepoints to one of the distinct blocks, which store 2 bits per codepoint.
+static constexpr uint32_t width_table_limit = 0x40000;
+static constexpr size_t width_block_size = 256;
+static constexpr size_t width_n_blocks = width_table_limit / width_block_size;
+
+using Width_block = std::array<uint64_t, width_block_size * 2 / 64>;
+
+/// @return Block of widths for codepoints [block * 256, block * 256 + 256).
+static constexpr Width_block make_width_block(size_t block)
+{
+    Width_block widths = {};
+    for (uint64_t& word : widths) { // Width 1 by default
+        word = 0x5555555555555555;
+    }
+    uint32_t first = block * width_block_size;
+    uint32_t last = first + width_block_size - 1;
+
+    // Whole words at a time, to stay well within the compiler's constexpr budget
+    auto paint = [&](const Width_range& range, uint64_t pattern) {
+        if (range.last < first || range.first > last) {
+            return;
+        }
+        uint32_t begin_bit = ((range.first > first ? range.first : first) - first) * 2;
+        uint32_t end_bit = ((range.last < last ? range.last : last) - first) * 2 + 2;
+        for (uint32_t word = begin_bit / 64; word * 64 < end_bit; word++) {
+            uint32_t low = begin_bit > word * 64 ? begin_bit - word * 64 : 0;
+            uint32_t high = end_bit < word * 64 + 64 ? end_bit - word * 64 : 64;
+            uint64_t mask = (high - low == 64 ? ~uint64_t(0) : ((uint64_t(1) << (high - low)) - 1)) << low;
+            widths[word] = (widths[word] & ~mask) | (pattern & mask);
+        }
+    };
+    for (const Width_range& range : zero_width_ranges) {
+        paint(range, 0);
+    }
+    for (const Width_range& range : wide_ranges) {
+        paint(range, 0xAAAAAAAAAAAAAAAA);
+    }
+    return widths;
+}
+
+static constexpr bool same_block(const Width_block& a, const Width_block& b)
+{
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i] != b[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <size_t N_blocks>
+struct Width_table
+{
+    std::array<uint8_t, width_n_blocks> block_of = {};
+    std::array<Width_block, N_blocks> blocks = {};
+    size_t n_distinct = 0;
+};
+
+/// @return Table with every block deduplicated, sized for the worst case.
+static constexpr Width_table<width_n_blocks> make_full_width_table()
+{
+    Width_table<width_n_blocks> table;
+    for (size_t block = 0; block < width_n_blocks; block++) {
+        Width_block widths = make_width_block(block);
+        size_t found = 0;
+        while (found < table.n_distinct && !same_block(table.blocks[found], widths)) {
+            found++;
+        }
+        if (found == table.n_distinct) {
+            table.blocks[table.n_distinct++] = widths;
+        }
+        table.block_of[block] = found;
+    }
+    return table;
+}
+
+static constexpr Width_table<width_n_blocks> full_width_table = make_full_width_table();
+static constexpr size_t n_width_blocks = full_width_table.n_distinct;
+static_assert(n_width_blocks <= 256, "Width blocks must be addressable by uint8_t");
+
+/// @return Copy of the full table trimmed to its distinct blocks; only this one ends up in the binary.
+static constexpr Width_table<n_width_blocks> make_width_table()
+{
+    Width_table<n_width_blocks> table;
+    table.block_of = full_width_table.block_of;
+    for (size_t block = 0; block < n_width_blocks; block++) {
+        table.blocks[block] = full_width_table.blocks[block];
+    }
+    table.n_distinct = n_width_blocks;
+    return table;
+}
+
+static constexpr Width_table<n_width_blocks> width_table = make_width_table();
+
+int codepoint_width(uint32_t codepoint)
+{
+    if (codepoint < 0x7F) {
+        return codepoint >= 0x20;
+    }
+    if (codepoint < 0xA0) { // C1 controls and DEL
+        return 0;
+    }
+    if (codepoint < width_table_limit) {
+        const Width_block& widths = width_table.blocks[width_table.block_of[codepoint / width_block_size]];
+        uint32_t bit = (codepoint % width_block_size) * 2;
+        return (widths[bit / 64] >> (bit % 64)) & 3;
+    }
+    if (codepoint >= 0xE0000 && codepoint <= 0xE0FFF) { // Tags and variation selectors
+        return 0;
+    }
+    return 1;
+}
+
+// UTF-8 __________________________________________________________________________________________
+
+uint32_t utf8_decode(std::string_view text, size_t& pos)
+{
+    const uint32_t replacement = 0xFFFD;
+    unsigned char lead = text[pos++];
+    if (lead < 0x80) {
+        return lead;
+    }
+    size_t n_continuation;
+    uint32_t codepoint;
+    uint32_t min_codepoint;
+    if ((lead & 0xE0) == 0xC0) {
+        n_continuation = 1;
+        codepoint = lead & 0x1F;
+        min_codepoint = 0x80;
+    }
+    else if ((lead & 0xF0) == 0xE0) {
+        n_continuation = 2;
+        codepoint = lead & 0x0F;
+        min_codepoint = 0x800;
+    }
+    else if ((lead & 0xF8) == 0xF0) {
+        n_continuation = 3;
+        codepoint = lead & 0x07;
+        min_codepoint = 0x10000;
+    }
+    else {
+        return replacement;
+    }
+    if (text.size() - pos < n_continuation) {
+        return replacement;
+    }
+    for (size_t i = 0; i < n_continuation; i++) {
+        unsigned char byte = text[pos + i];
+        if ((byte & 0xC0) != 0x80) {
+            return replacement;
+        }
+        codepoint = (codepoint << 6) | (byte & 0x3F);
+    }
+    // Overlong encodings, surrogates and values past Unicode are invalid
+    if (codepoint < min_codepoint || codepoint > 0x10FFFF || (codepoint >= 0xD800 && codepoint <= 0xDFFF)) {
+        return replacement;
+    }
+    pos += n_continuation;
+    return codepoint;
+}
+
+size_t display_width(std::string_view text)
+{
+    size_t width = 0;
+    for (size_t pos = 0; pos < text.size();) {
+        width += codepoint_width(utf8_decode(text, pos));
+    }
+    return width;
+}
+
+// Wrapping _______________________________________________________________________________________
+
+/// @brief Wraps one paragraph (text without newlines) and calls emit(offset, length) for every line.
+///        Lines are contiguous in the paragraph and lose their trailing spaces.
+template <typename Emit>
+static void wrap_paragraph(std::string_view paragraph, size_t width, Emit&& emit)
+{
+    size_t line_start = 0;
+    size_t line_end = 0;
+    size_t line_columns = 0;
+
+    auto end_line = [&]() {
+        size_t length = line_end - line_start;
+        while (length > 0 && paragraph[line_start + length - 1] == ' ') {
+            length--;
+        }
+        emit(line_start, length);
+    };
+
+    size_t pos = 0;
+    while (true) {
+        size_t word_start = pos;
+        size_t word_columns = 0;
+        while (pos < paragraph.size() && paragraph[pos] != ' ') {
+            word_columns += codepoint_width(utf8_decode(paragraph, pos));
+        }
+        size_t word_end = pos;
+
+        if (word_end != word_start) {
+            // Spaces skipped on a full line also push the word to the next one
+            if (width > 0 && (line_columns + word_columns > width || line_end != word_start)) {
+                if (line_end != line_start) {
+                    end_line();
+                }
+                line_start = line_end = word_start;
+                line_columns = 0;
+
+                if (word_columns > width) { // Split between codepoints; a single codepoint always fits
+                    for (size_t cut = word_start; cut < word_end;) {
+                        size_t next = cut;
+                        size_t columns = codepoint_width(utf8_decode(paragraph, next));
+                        if (line_columns + columns > width && line_columns > 0) {
+                            line_end = cut;
+                            end_line();
+                            line_start = cut;
+                            line_columns = 0;
+                        }
+                        line_columns += columns;
+                        cut = next;
+                    }
+                    word_columns = 0;
+                }
+            }
+            line_end = word_end;
+            line_columns += word_columns;
+        }
+        if (pos == paragraph.size()) {
+            break;
+        }
+        pos++; // Space
+        if (width == 0 || line_columns < width) {
+            line_end = pos;
+            line_columns++;
+        }
+    }
+    end_line();
+}
+
+void wrap_text_utf8(std::string_view text, int32_t line_width, std::vector<std::string_view>& lines)
+{
+    lines.clear();
+    size_t width = line_width > 0 ? line_width : 0;
+
+    size_t paragraph_start = 0;
+    while (true) {
+        size_t paragraph_end = std::min(text.find('\n', paragraph_start), text.size());
+        std::string_view paragraph = text.substr(paragraph_start, paragraph_end - paragraph_start);
+        wrap_paragraph(paragraph, width, [&](size_t offset, size_t length) {
+            lines.push_back(paragraph.substr(offset, length));
+        });
+        if (paragraph_end == text.size()) {
+            break;
+        }
+        paragraph_start = paragraph_end + 1;
+    }
+}
+
+// Fenwick_tree ___________________________________________________________________________________
+
+void Text_layout::Fenwick_tree::assign(const std::vector<size_t>& values)
+{
+    tree.assign(values.size() + 1, 0);
+    for (size_t i = 1; i < tree.size(); i++) {
+        tree[i] += values[i - 1];
+        size_t parent = i + (i & -i);
+        if (parent < tree.size()) {
+            tree[parent] += tree[i];
+        }
+    }
+}
+
+void Text_layout::Fenwick_tree::add(size_t index, ptrdiff_t delta)
+{
+    for (size_t i = index + 1; i < tree.size(); i += i & -i) {
+        tree[i] += delta;
+    }
+}
+
+size_t Text_layout::Fenwick_tree::prefix(size_t count) const
+{
+    size_t sum = 0;
+    for (size_t i = count; i > 0; i -= i & -i) {
+        sum += tree[i];
+    }
+    return sum;
+}
+
+size_t Text_layout::Fenwick_tree::find(size_t& k) const
+{
+    size_t position = 0;
+    size_t step = 1;
+    while (step * 2 < tree.size()) {
+        step *= 2;
+    }
+    for (; step > 0; step /= 2) {
+        if (position + step < tree.size() && tree[position + step] <= k) {
+            position += step;
+            k -= tree[position];
+        }
+    }
+    return position;
+}
+
+// Text_layout ____________________________________________________________________________________
+
+Text_layout::Text_layout(int32_t line_width) : line_width(line_width)
+{
+    set_text("");
+}
+
+void Text_layout::wrap(Paragraph& paragraph) const
+{
+    paragraph.lines.clear();
+    wrap_paragraph(paragraph.text, line_width > 0 ? line_width : 0, [&](size_t offset, size_t length) {
+        paragraph.lines.push_back({offset, length});
+    });
+}
+
+void Text_layout::rebuild_index()
+{
+    std::vector<size_t> line_counts(paragraphs.size());
+    for (size_t i = 0; i < paragraphs.size(); i++) {
+        line_counts[i] = paragraphs[i].lines.size();
+    }
+    line_index.assign(line_counts);
+}
+
+void Text_layout::set_width(int32_t line_width)
+{
+    this->line_width = line_width;
+    for (Paragraph& paragraph : paragraphs) {
+        wrap(paragraph);
+    }
+    rebuild_index();
+}
+
+void Text_layout::set_text(std::string_view text)
+{
+    paragraphs.clear();
+    replace_paragraphs(0, 0, text);
+}
+
+std::string Text_layout::text() const
+{
+    std::string result;
+    for (size_t i = 0; i < paragraphs.size(); i++) {
+        if (i > 0) {
+            result += '\n';
+        }
+        result += paragraphs[i].text;
+    }
+    return result;
+}
+
+void Text_layout::replace_paragraphs(size_t first, size_t count, std::string_view text)
+{
+    std::vector<Paragraph> replacement;
+    size_t paragraph_start = 0;
+    while (true) {
+        size_t paragraph_end = std::min(text.find('\n', paragraph_start), text.size());
+        replacement.push_back({std::string(text.substr(paragraph_start, paragraph_end - paragraph_start)), {}});
+        wrap(replacement.back());
+        if (paragraph_end == text.size()) {
+            break;
+        }
+        paragraph_start = paragraph_end + 1;
+    }
+
+    if (replacement.size() == count) { // Same shape -- only update line counts
+        for (size_t i = 0; i < count; i++) {
+            Paragraph& paragraph = paragraphs[first + i];
+            line_index.add(first + i, static_cast<ptrdiff_t>(replacement[i].lines.size()) - paragraph.lines.size());
+            paragraph = std::move(replacement[i]);
+        }
+        return;
+    }
+    paragraphs.erase(paragraphs.begin() + first, paragraphs.begin() + first + count);
+    paragraphs.insert(paragraphs.begin() + first, std::make_move_iterator(replacement.begin()),
+                      std::make_move_iterator(replacement.end()));
+    rebuild_index();
+}
+
+void Text_layout::erase_paragraphs(size_t first, size_t count)
+{
+    paragraphs.erase(paragraphs.begin() + first, paragraphs.begin() + first + count);
+    rebuild_index();
+}
+
+std::pair<size_t, size_t> Text_layout::locate_line(size_t index) const
+{
+    if (index >= n_lines()) {
+        return {paragraphs.size(), 0};
+    }
+    size_t paragraph = line_index.find(index);
+    return {paragraph, index};
+}
+
+std::string_view Text_layout::line(size_t index) const
+{
+    std::pair<size_t, size_t> location = locate_line(index);
+    if (location.first == paragraphs.size()) {
+        return {};
+    }
+    const Paragraph& paragraph = paragraphs[location.first];
+    const Line& line = paragraph.lines[location.second];
+    return std::string_view(paragraph.text).substr(line.offset, line.length);
+}
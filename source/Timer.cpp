@@ -1,36 +1,104 @@
 #include <sztronics/miscellaneous/Timer.hpp>
+#include <sztronics/miscellaneous/Profiler.hpp>
 
-Timer::Timed_event::Timed_event(std::function<void(void)> event, float t_seconds, int n_repeat) : 
-    event(event), t_seconds(t_seconds), \
-    countdown(t_seconds), mutex(), \
+#include <algorithm>
+#include <utility>
+#include <time.h>
+
+Timer::Timed_event::Timed_event(std::function<void(void)> event, Duration period, int n_repeat) : 
+    event(event), mutex(), \
+    period(period), countdown(period), \
     n_repeat(n_repeat) {}
 
+Timer::Timed_event::Timed_event(std::function<void(void)> event, float t_seconds, int n_repeat) : 
+    Timed_event(event, std::chrono::duration_cast<Duration>(std::chrono::duration<float>(t_seconds)), n_repeat) {}
+
+
+
+Timer::Duration Timer::steady_now() 
+{
+    return std::chrono::duration_cast<Duration>(std::chrono::steady_clock::now().time_since_epoch());
+}
+
+Timer::Duration Timer::raw_now()
+{
+#if defined(__linux__) && defined(CLOCK_MONOTONIC_RAW)
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+    return std::chrono::seconds(now.tv_sec) + Duration(now.tv_nsec);
+#else
+    return steady_now();
+#endif
+}
+
 
 
-float Timer::get_cur_time_s() {
-    auto now = std::chrono::steady_clock::now();
-    auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+Timer::Timer(Clock clock) : clock(clock), events(), \
+                            delta_time(Duration::zero()), \
+                            prev_time(clock()), skip_stalled(true), \
+                            wheel_origin(prev_time)
+{
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        std::fill(std::begin(wheel[level]), std::end(wheel[level]), no_node);
+    }
+}
 
-    return static_cast<float>(nanoseconds)/1000000000.0;
+Timer::~Timer()
+{
+    stop_executor();
+    join_stopped_threads();
 }
 
+Timer::Timer(Timer&& other) : Timer(other.clock)
+{
+    *this = std::move(other);
+}
+
+Timer& Timer::operator=(Timer&& other)
+{
+    if (this == &other) {
+        return *this;
+    }
+    stop_executor();
+    other.stop_executor();
+    std::scoped_lock lock(wheel_mutex, other.wheel_mutex);
+
+    clock = std::move(other.clock);
+    prev_time = other.prev_time;
+    delta_time = other.delta_time;
+    events = std::move(other.events);
+    skip_stalled = other.skip_stalled.load();
 
+    wheel_origin = other.wheel_origin;
+    process_time = other.process_time;
+    cur_tick = other.cur_tick;
+    n_wheel_events = std::exchange(other.n_wheel_events, 0);
+    nodes = std::move(other.nodes);
+    free_nodes = std::move(other.free_nodes);
+    due_scratch = std::move(other.due_scratch);
+    std::copy(&other.wheel[0][0], &other.wheel[0][0] + TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS, &wheel[0][0]);
+    std::copy(std::begin(other.occupied), std::end(other.occupied), std::begin(occupied));
 
-Timer::Timer() : events(), delta_time(0), \
-                 prev_time(get_cur_time_s()), skip_stalled(true) {}
+    other.nodes.clear();
+    other.free_nodes.clear();
+    std::fill(&other.wheel[0][0], &other.wheel[0][0] + TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS, no_node);
+    std::fill(std::begin(other.occupied), std::end(other.occupied), 0);
+    return *this;
+}
 
 
                  
 void Timer::process()
 {
-    float cur_time = get_cur_time_s();
+    PROFILE_ZONE("Timer::process");
+    Duration cur_time = clock();
 
     delta_time = cur_time - prev_time;
 
     for (int ev_id = 0; ev_id < events.size(); ev_id++)
     {
         events[ev_id].countdown -= delta_time;
-        while(events[ev_id].countdown <= 0.0)
+        while(events[ev_id].countdown <= Duration::zero())
         {
             // Lock mutex if provided
             std::optional<std::lock_guard<std::mutex>> opt_lock;
@@ -50,12 +118,433 @@ void Timer::process()
             events[ev_id].event();
 
             if (skip_stalled) {
-                events[ev_id].countdown = events[ev_id].t_seconds;
+                events[ev_id].countdown = events[ev_id].period;
             }
             else {
-                events[ev_id].countdown += events[ev_id].t_seconds;
+                events[ev_id].countdown += events[ev_id].period;
             }
         }
     }
     prev_time = cur_time;
-}
\ No newline at end of file
+
+    std::vector<Event_handle> due;
+    {
+        std::lock_guard<std::mutex> lock(wheel_mutex);
+        if (executor_active) { // Wheel belongs to the timer thread
+            return;
+        }
+        due.swap(due_scratch); // Reuse capacity, but stay correct if an event calls process()
+        process_time = cur_time - wheel_origin;
+        collect_due(std::max<int64_t>(process_time.count(), 0) / TIMER_WHEEL_RESOLUTION_NS, due);
+    }
+    for (size_t i = 0; i < due.size(); i++) {
+        if (fire(due[i])) { // Still behind -- fire again right away
+            due.push_back(due[i]);
+        }
+    }
+    due.clear();
+
+    std::lock_guard<std::mutex> lock(wheel_mutex);
+    if (due_scratch.capacity() < due.capacity()) {
+        due_scratch.swap(due);
+    }
+}
+
+
+
+uint64_t Timer::ticks_until(Duration time)
+{
+    if (time <= Duration::zero()) {
+        return 0;
+    }
+    // Round up so that events never fire early
+    return (time.count() + TIMER_WHEEL_RESOLUTION_NS - 1) / TIMER_WHEEL_RESOLUTION_NS;
+}
+
+Timer::Event_handle Timer::schedule(Timed_event event)
+{
+    std::lock_guard<std::mutex> lock(wheel_mutex);
+
+    uint32_t index;
+    if (!free_nodes.empty()) {
+        index = free_nodes.back();
+        free_nodes.pop_back();
+        nodes[index].event = std::move(event);
+    }
+    else {
+        index = nodes.size();
+        nodes.emplace_back(std::move(event));
+    }
+    Wheel_node& node = nodes[index];
+    node.in_use = true;
+    node.cancelled = false;
+    n_wheel_events++;
+
+    // Count from the actual time, but never into a slot that has already been processed
+    node.deadline = clock() - wheel_origin + node.event.countdown;
+    node.expires = std::max(ticks_until(node.deadline), cur_tick + 1);
+    link(index);
+    wheel_changed.notify_one();
+
+    return {index, node.generation};
+}
+
+size_t Timer::n_scheduled() const
+{
+    std::lock_guard<std::mutex> lock(wheel_mutex);
+    return n_wheel_events;
+}
+
+bool Timer::is_scheduled(Event_handle handle) const
+{
+    std::lock_guard<std::mutex> lock(wheel_mutex);
+    return handle.index < nodes.size() && \
+           nodes[handle.index].in_use && \
+           nodes[handle.index].generation == handle.generation && \
+           !nodes[handle.index].cancelled;
+}
+
+bool Timer::cancel(Event_handle handle)
+{
+    std::lock_guard<std::mutex> lock(wheel_mutex);
+
+    if (handle.index >= nodes.size() || !nodes[handle.index].in_use || \
+        nodes[handle.index].generation != handle.generation || nodes[handle.index].cancelled) {
+        return false;
+    }
+    if (nodes[handle.index].level >= 0) {
+        unlink(handle.index);
+        release(handle.index);
+    }
+    else { // Due or being fired right now -- let fire() release it
+        nodes[handle.index].cancelled = true;
+    }
+    return true;
+}
+
+void Timer::link(uint32_t index)
+{
+    Wheel_node& node = nodes[index];
+    uint64_t delta = node.expires > cur_tick ? node.expires - cur_tick : 0;
+    uint64_t placed_at = node.expires;
+
+    int level = 0;
+    while (level < TIMER_WHEEL_LEVELS - 1 && delta >= (uint64_t(1) << (8 * (level + 1)))) {
+        level++;
+    }
+    // Too far in the future: park in the furthest slot, it will be relinked on cascade
+    if (delta >= (uint64_t(1) << (8 * TIMER_WHEEL_LEVELS))) {
+        placed_at = cur_tick + (uint64_t(1) << (8 * TIMER_WHEEL_LEVELS)) - 1;
+    }
+    uint8_t slot = (placed_at >> (8 * level)) & (TIMER_WHEEL_SLOTS - 1);
+
+    node.level = level;
+    node.slot = slot;
+    node.prev = no_node;
+    node.next = wheel[level][slot];
+    if (node.next != no_node) {
+        nodes[node.next].prev = index;
+    }
+    wheel[level][slot] = index;
+
+    if (level == 0) {
+        occupied[slot / 64] |= uint64_t(1) << (slot % 64);
+    }
+}
+
+void Timer::unlink(uint32_t index)
+{
+    Wheel_node& node = nodes[index];
+
+    if (node.prev != no_node) {
+        nodes[node.prev].next = node.next;
+    }
+    else {
+        wheel[node.level][node.slot] = node.next;
+    }
+    if (node.next != no_node) {
+        nodes[node.next].prev = node.prev;
+    }
+    if (node.level == 0 && wheel[0][node.slot] == no_node) {
+        occupied[node.slot / 64] &= ~(uint64_t(1) << (node.slot % 64));
+    }
+    node.level = -1;
+    node.prev = node.next = no_node;
+}
+
+void Timer::release(uint32_t index)
+{
+    Wheel_node& node = nodes[index];
+    node.in_use = false;
+    node.cancelled = false;
+    node.generation++;
+    node.event.event = nullptr; // Drop captured state now rather than on reuse
+    node.event.mutex.reset();
+
+    free_nodes.push_back(index);
+    n_wheel_events--;
+}
+
+void Timer::cascade(int level)
+{
+    uint8_t slot = (cur_tick >> (8 * level)) & (TIMER_WHEEL_SLOTS - 1);
+    uint32_t index = wheel[level][slot];
+    wheel[level][slot] = no_node;
+
+    // Relink every node closer to the ground level
+    while (index != no_node) {
+        uint32_t next = nodes[index].next;
+        nodes[index].level = -1;
+        link(index);
+        index = next;
+    }
+}
+
+uint64_t Timer::next_ground_tick(uint64_t limit) const
+{
+    uint64_t boundary = (cur_tick | (TIMER_WHEEL_SLOTS - 1)) + 1;
+    limit = std::min(limit, boundary);
+
+    unsigned from = (cur_tick + 1) & (TIMER_WHEEL_SLOTS - 1);
+    unsigned to = (limit == boundary) ? TIMER_WHEEL_SLOTS - 1 : limit & (TIMER_WHEEL_SLOTS - 1);
+    if (from == 0) {
+        return limit;
+    }
+    for (unsigned word = from / 64; word <= to / 64; word++) {
+        uint64_t bits = occupied[word];
+        if (word == from / 64) {
+            bits &= ~uint64_t(0) << (from % 64);
+        }
+        if (bits != 0) {
+            unsigned slot = word * 64 + __builtin_ctzll(bits);
+            if (slot <= to) {
+                return (cur_tick & ~uint64_t(TIMER_WHEEL_SLOTS - 1)) + slot;
+            }
+            break;
+        }
+    }
+    return limit;
+}
+
+void Timer::collect_due(uint64_t target_tick, std::vector<Event_handle>& due)
+{
+    while (cur_tick < target_tick)
+    {
+        if (n_wheel_events == 0) {
+            cur_tick = target_tick;
+            break;
+        }
+        // Jump to the next non-empty ground slot, but stop at every
+        // slot boundary so that higher levels cascade in time
+        cur_tick = next_ground_tick(target_tick);
+
+        if ((cur_tick & (TIMER_WHEEL_SLOTS - 1)) == 0) {
+            for (int level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+                cascade(level);
+                if (((cur_tick >> (8 * level)) & (TIMER_WHEEL_SLOTS - 1)) != 0) {
+                    break;
+                }
+            }
+        }
+        uint8_t slot = cur_tick & (TIMER_WHEEL_SLOTS - 1);
+        for (uint32_t index = wheel[0][slot]; index != no_node; index = nodes[index].next) {
+            due.push_back({index, nodes[index].generation});
+            nodes[index].level = -1;
+        }
+        wheel[0][slot] = no_node;
+        occupied[slot / 64] &= ~(uint64_t(1) << (slot % 64));
+    }
+}
+
+bool Timer::fire(Event_handle handle)
+{
+    Wheel_node* node;
+    {
+        std::lock_guard<std::mutex> lock(wheel_mutex);
+        node = &nodes[handle.index];
+        if (!node->in_use || node->generation != handle.generation) {
+            return false;
+        }
+        if (node->cancelled || node->event.n_repeat == 0) {
+            release(handle.index);
+            return false;
+        }
+        if (node->event.n_repeat > 0) {
+            node->event.n_repeat--;
+        }
+    }
+    {
+        // Lock mutex if provided
+        std::optional<std::lock_guard<std::mutex>> opt_lock;
+        if (node->event.mutex.has_value()) {
+            opt_lock.emplace(node->event.mutex->get());
+        }
+        node->event.event();
+    }
+    std::lock_guard<std::mutex> lock(wheel_mutex);
+
+    if (node->cancelled || node->event.n_repeat == 0) {
+        release(handle.index);
+        return false;
+    }
+    Duration period = std::max(node->event.period, Duration(1));
+
+    if (skip_stalled) {
+        node->deadline = process_time + period;
+    }
+    else {
+        node->deadline += period;
+    }
+    node->expires = ticks_until(node->deadline);
+    if (node->expires <= cur_tick) {
+        if (!skip_stalled) {
+            return true;
+        }
+        node->expires = cur_tick + 1;
+    }
+    link(handle.index);
+    wheel_changed.notify_one();
+    return false;
+}
+
+void Timer::start_executor(unsigned n_workers)
+{
+    join_stopped_threads();
+    std::lock_guard<std::mutex> lock(wheel_mutex);
+    if (executor_active) {
+        return;
+    }
+    if (n_workers == 0) {
+        n_workers = std::max(1u, std::thread::hardware_concurrency());
+    }
+    executor_active = true;
+    executor_generation++;
+    timer_thread = std::thread(&Timer::run_timer_thread, this, executor_generation);
+    for (unsigned i = 0; i < n_workers; i++) {
+        workers.emplace_back(&Timer::run_worker, this, executor_generation);
+    }
+}
+
+void Timer::stop_executor()
+{
+    join_stopped_threads();
+    std::vector<std::thread> threads;
+    {
+        std::lock_guard<std::mutex> lock(wheel_mutex);
+        if (!executor_active) {
+            return;
+        }
+        executor_active = false;
+        threads.swap(workers);
+        threads.push_back(std::move(timer_thread));
+    }
+    wheel_changed.notify_all();
+    dispatch_ready.notify_all();
+
+    for (std::thread& thread : threads) {
+        if (thread.get_id() == std::this_thread::get_id()) {
+            // Called from an event -- this worker exits once the event returns
+            std::lock_guard<std::mutex> lock(wheel_mutex);
+            stopped_threads.push_back(std::move(thread));
+        }
+        else {
+            thread.join();
+        }
+    }
+
+    // Return events that never reached a worker
+    std::lock_guard<std::mutex> lock(wheel_mutex);
+    for (Event_handle handle : dispatch_queue) {
+        return_to_wheel(handle);
+    }
+    dispatch_queue.clear();
+}
+
+void Timer::return_to_wheel(Event_handle handle)
+{
+    Wheel_node& node = nodes[handle.index];
+    if (!node.in_use || node.generation != handle.generation) {
+        return;
+    }
+    if (node.cancelled) {
+        release(handle.index);
+        return;
+    }
+    node.expires = cur_tick + 1;
+    link(handle.index);
+}
+
+void Timer::join_stopped_threads()
+{
+    std::vector<std::thread> threads;
+    {
+        std::lock_guard<std::mutex> lock(wheel_mutex);
+        threads.swap(stopped_threads);
+    }
+    for (std::thread& thread : threads) {
+        if (thread.get_id() == std::this_thread::get_id()) {
+            std::lock_guard<std::mutex> lock(wheel_mutex);
+            stopped_threads.push_back(std::move(thread));
+        }
+        else {
+            thread.join();
+        }
+    }
+}
+
+bool Timer::executor_running() const
+{
+    std::lock_guard<std::mutex> lock(wheel_mutex);
+    return executor_active;
+}
+
+void Timer::run_timer_thread(uint64_t generation)
+{
+    std::vector<Event_handle> due;
+    std::unique_lock<std::mutex> lock(wheel_mutex);
+
+    while (executor_current(generation))
+    {
+        process_time = clock() - wheel_origin;
+        collect_due(std::max<int64_t>(process_time.count(), 0) / TIMER_WHEEL_RESOLUTION_NS, due);
+        if (!due.empty()) {
+            dispatch_queue.insert(dispatch_queue.end(), due.begin(), due.end());
+            due.clear();
+            dispatch_ready.notify_all();
+        }
+        if (n_wheel_events == 0) {
+            wheel_changed.wait(lock);
+            continue;
+        }
+        // Sleep until the next occupied ground slot, or the next cascade if there is none
+        uint64_t wake_tick = next_ground_tick(UINT64_MAX);
+        Duration wake_time = wheel_origin + Duration(wake_tick * TIMER_WHEEL_RESOLUTION_NS);
+        wheel_changed.wait_for(lock, wake_time - clock());
+    }
+}
+
+void Timer::run_worker(uint64_t generation)
+{
+    std::unique_lock<std::mutex> lock(wheel_mutex);
+
+    while (true)
+    {
+        dispatch_ready.wait(lock, [&]() { return !dispatch_queue.empty() || !executor_current(generation); });
+        if (!executor_current(generation)) {
+            return;
+        }
+        Event_handle handle = dispatch_queue.front();
+        dispatch_queue.pop_front();
+
+        lock.unlock();
+        bool behind = fire(handle);
+        lock.lock();
+
+        if (behind && executor_current(generation)) {
+            dispatch_queue.push_back(handle);
+        }
+        else if (behind) { // The executor was stopped while the event ran
+            return_to_wheel(handle);
+        }
+    }
+}
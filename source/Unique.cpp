@@ -1,4 +1,5 @@
 #include <sztronics/miscellaneous/Unique.hpp>
+#include <sztronics/miscellaneous/Profiler.hpp>
 #include <iostream>
 
 std::vector<bool> Unique::claimed_ids = {};
@@ -6,6 +7,7 @@ std::mutex Unique::id_mutex;
 
 Unique::Unique()
 {
+    PROFILE_ZONE("Unique::Unique");
     std::lock_guard<std::mutex> lock(id_mutex);
     bool id_found = false;
     for(int i = 0; i < UNIQUE_ENTITY_LIMIT; i++) {
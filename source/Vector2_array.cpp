@@ -0,0 +1,84 @@
+#include <sztronics/miscellaneous/Vector2_array.hpp>
+
+#include "Vector2_array_kernels.hpp"
+
+// Widest instruction set the whole library is compiled for
+#if defined(__AVX2__)
+#define VECTOR2_BATCH_ISA "avx2"
+using Baseline_pack = Avx2_pack;
+#elif defined(__SSE2__)
+#define VECTOR2_BATCH_ISA "sse2"
+using Baseline_pack = Sse2_pack;
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define VECTOR2_BATCH_ISA "neon"
+using Baseline_pack = Neon_pack;
+#else
+#define VECTOR2_BATCH_ISA "scalar"
+using Baseline_pack = Scalar_pack;
+#endif
+
+/// @brief Kernels for the widest instruction set of the running CPU, picked on first use.
+///        With SZTRONICS_SIMD_DISPATCH, AVX2 kernels are used whenever the CPU has AVX2,
+///        even if the rest of the library targets plain x86-64.
+static const Vector2_batch_table& batch_kernels()
+{
+    static const Vector2_batch_table table = []() {
+#if defined(SZTRONICS_SIMD_DISPATCH) && !defined(__AVX2__)
+        if (__builtin_cpu_supports("avx2")) {
+            return vector2_batch_table_avx2();
+        }
+#endif
+        return make_vector2_batch_table<Baseline_pack>(VECTOR2_BATCH_ISA);
+    }();
+    return table;
+}
+
+void vector2_batch_add(float* xs, float* ys, const float* other_xs, const float* other_ys, size_t n)
+{
+    batch_kernels().add(xs, ys, other_xs, other_ys, n);
+}
+
+void vector2_batch_add(float* xs, float* ys, float dx, float dy, size_t n)
+{
+    batch_kernels().add_offset(xs, ys, dx, dy, n);
+}
+
+void vector2_batch_scale(float* xs, float* ys, float fx, float fy, size_t n)
+{
+    batch_kernels().scale(xs, ys, fx, fy, n);
+}
+
+void vector2_batch_dot(const float* xs, const float* ys, const float* other_xs, const float* other_ys, float* out, size_t n)
+{
+    batch_kernels().dot(xs, ys, other_xs, other_ys, out, n);
+}
+
+void vector2_batch_len(const float* xs, const float* ys, float* out, size_t n)
+{
+    batch_kernels().len(xs, ys, out, n);
+}
+
+void vector2_batch_normalize(float* xs, float* ys, size_t n)
+{
+    batch_kernels().normalize(xs, ys, n);
+}
+
+void vector2_batch_clamp(float* xs, float* ys, Vector2f upper_bound, Vector2f lower_bound, size_t n)
+{
+    batch_kernels().clamp(xs, ys, upper_bound, lower_bound, n);
+}
+
+void vector2_batch_len_manh(const float* xs, const float* ys, float* out, size_t n)
+{
+    batch_kernels().len_manh(xs, ys, out, n);
+}
+
+void vector2_batch_len_chess(const float* xs, const float* ys, float* out, size_t n)
+{
+    batch_kernels().len_chess(xs, ys, out, n);
+}
+
+const char* vector2_batch_isa()
+{
+    return batch_kernels().isa;
+}
@@ -0,0 +1,10 @@
+// Compiled with -mavx2 when SZTRONICS_SIMD_DISPATCH is on; see CMakeLists.txt.
+// Nothing here may run before batch_kernels() has checked the CPU.
+#include "Vector2_array_kernels.hpp"
+
+#if defined(SZTRONICS_SIMD_DISPATCH) && defined(__AVX2__)
+Vector2_batch_table vector2_batch_table_avx2()
+{
+    return make_vector2_batch_table<Avx2_pack>("avx2");
+}
+#endif
@@ -0,0 +1,228 @@
+#pragma once
+
+#include <cstddef>
+#include <math.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#include <sztronics/miscellaneous/Vector2.hpp>
+
+// Every kernel is written once against a "pack" of floats and instantiated
+// for the widest available instruction set, then for single floats to handle the tail.
+// This header is included by translation units compiled with different -m flags,
+// so everything in it has internal linkage: the linker must never merge an AVX2
+// copy of an inline function into code that runs on CPUs without AVX2.
+
+/// @brief Entry points of one instantiation of the kernels.
+struct Vector2_batch_table
+{
+    const char* isa;
+    void (*add)(float* xs, float* ys, const float* other_xs, const float* other_ys, size_t n);
+    void (*add_offset)(float* xs, float* ys, float dx, float dy, size_t n);
+    void (*scale)(float* xs, float* ys, float fx, float fy, size_t n);
+    void (*dot)(const float* xs, const float* ys, const float* other_xs, const float* other_ys, float* out, size_t n);
+    void (*len)(const float* xs, const float* ys, float* out, size_t n);
+    void (*normalize)(float* xs, float* ys, size_t n);
+    void (*clamp)(float* xs, float* ys, Vector2f upper_bound, Vector2f lower_bound, size_t n);
+    void (*len_manh)(const float* xs, const float* ys, float* out, size_t n);
+    void (*len_chess)(const float* xs, const float* ys, float* out, size_t n);
+};
+
+/// @return Kernels compiled for AVX2, from Vector2_array_avx2.cpp.
+///         Only call when the CPU supports AVX2.
+Vector2_batch_table vector2_batch_table_avx2();
+
+namespace {
+
+/// @brief Single float, used for array tails and when no SIMD is available.
+struct Scalar_pack
+{
+    using reg = float;
+    static constexpr size_t width = 1;
+
+    static inline reg load(const float* ptr) { return *ptr; }
+    static inline void store(float* ptr, reg val) { *ptr = val; }
+    static inline reg set(float val) { return val; }
+    static inline reg add(reg a, reg b) { return a + b; }
+    static inline reg mul(reg a, reg b) { return a * b; }
+    static inline reg div(reg a, reg b) { return a / b; }
+    // Same results as std::min/std::max, without instantiating shared std templates
+    static inline reg min(reg a, reg b) { return b < a ? b : a; }
+    static inline reg max(reg a, reg b) { return a < b ? b : a; }
+    static inline reg sqrt(reg a) { return sqrtf(a); }
+    static inline reg abs(reg a) { return fabsf(a); }
+    /// @return a where mask > 0, zero elsewhere.
+    static inline reg keep_positive(reg a, reg mask) { return mask > 0.0f ? a : 0.0f; }
+};
+
+#if defined(__AVX2__)
+struct Avx2_pack
+{
+    using reg = __m256;
+    static constexpr size_t width = 8;
+
+    static inline reg load(const float* ptr) { return _mm256_loadu_ps(ptr); }
+    static inline void store(float* ptr, reg val) { _mm256_storeu_ps(ptr, val); }
+    static inline reg set(float val) { return _mm256_set1_ps(val); }
+    static inline reg add(reg a, reg b) { return _mm256_add_ps(a, b); }
+    static inline reg mul(reg a, reg b) { return _mm256_mul_ps(a, b); }
+    static inline reg div(reg a, reg b) { return _mm256_div_ps(a, b); }
+    static inline reg min(reg a, reg b) { return _mm256_min_ps(b, a); }
+    static inline reg max(reg a, reg b) { return _mm256_max_ps(b, a); }
+    static inline reg sqrt(reg a) { return _mm256_sqrt_ps(a); }
+    static inline reg abs(reg a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+    static inline reg keep_positive(reg a, reg mask) { 
+        return _mm256_and_ps(a, _mm256_cmp_ps(mask, _mm256_setzero_ps(), _CMP_GT_OQ)); 
+    }
+};
+#endif
+
+#if defined(__SSE2__)
+struct Sse2_pack
+{
+    using reg = __m128;
+    static constexpr size_t width = 4;
+
+    static inline reg load(const float* ptr) { return _mm_loadu_ps(ptr); }
+    static inline void store(float* ptr, reg val) { _mm_storeu_ps(ptr, val); }
+    static inline reg set(float val) { return _mm_set1_ps(val); }
+    static inline reg add(reg a, reg b) { return _mm_add_ps(a, b); }
+    static inline reg mul(reg a, reg b) { return _mm_mul_ps(a, b); }
+    static inline reg div(reg a, reg b) { return _mm_div_ps(a, b); }
+    static inline reg min(reg a, reg b) { return _mm_min_ps(b, a); }
+    static inline reg max(reg a, reg b) { return _mm_max_ps(b, a); }
+    static inline reg sqrt(reg a) { return _mm_sqrt_ps(a); }
+    static inline reg abs(reg a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+    static inline reg keep_positive(reg a, reg mask) { 
+        return _mm_and_ps(a, _mm_cmpgt_ps(mask, _mm_setzero_ps())); 
+    }
+};
+#endif
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+struct Neon_pack
+{
+    using reg = float32x4_t;
+    static constexpr size_t width = 4;
+
+    static inline reg load(const float* ptr) { return vld1q_f32(ptr); }
+    static inline void store(float* ptr, reg val) { vst1q_f32(ptr, val); }
+    static inline reg set(float val) { return vdupq_n_f32(val); }
+    static inline reg add(reg a, reg b) { return vaddq_f32(a, b); }
+    static inline reg mul(reg a, reg b) { return vmulq_f32(a, b); }
+    static inline reg div(reg a, reg b) { return vdivq_f32(a, b); }
+    static inline reg min(reg a, reg b) { return vminq_f32(a, b); }
+    static inline reg max(reg a, reg b) { return vmaxq_f32(a, b); }
+    static inline reg sqrt(reg a) { return vsqrtq_f32(a); }
+    static inline reg abs(reg a) { return vabsq_f32(a); }
+    static inline reg keep_positive(reg a, reg mask) { 
+        return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a), vcgtq_f32(mask, vdupq_n_f32(0.0f))));
+    }
+};
+#endif
+
+/// @brief Runs kernel over [0, n) with the widest pack, then finishes the tail one float at a time.
+/// @param kernel Generic callable taking (pack tag, index).
+template <typename Simd_pack, typename Kernel>
+inline void for_each_pack(size_t n, Kernel kernel)
+{
+    size_t i = 0;
+    if constexpr (Simd_pack::width > 1) {
+        for (; i + Simd_pack::width <= n; i += Simd_pack::width) {
+            kernel(Simd_pack(), i);
+        }
+    }
+    for (; i < n; i++) {
+        kernel(Scalar_pack(), i);
+    }
+}
+
+template <typename Simd_pack>
+Vector2_batch_table make_vector2_batch_table(const char* isa)
+{
+    Vector2_batch_table table;
+    table.isa = isa;
+
+    table.add = [](float* xs, float* ys, const float* other_xs, const float* other_ys, size_t n) {
+        for_each_pack<Simd_pack>(n, [=](auto pack, size_t i) {
+            using P = decltype(pack);
+            P::store(xs + i, P::add(P::load(xs + i), P::load(other_xs + i)));
+            P::store(ys + i, P::add(P::load(ys + i), P::load(other_ys + i)));
+        });
+    };
+
+    table.add_offset = [](float* xs, float* ys, float dx, float dy, size_t n) {
+        for_each_pack<Simd_pack>(n, [=](auto pack, size_t i) {
+            using P = decltype(pack);
+            P::store(xs + i, P::add(P::load(xs + i), P::set(dx)));
+            P::store(ys + i, P::add(P::load(ys + i), P::set(dy)));
+        });
+    };
+
+    table.scale = [](float* xs, float* ys, float fx, float fy, size_t n) {
+        for_each_pack<Simd_pack>(n, [=](auto pack, size_t i) {
+            using P = decltype(pack);
+            P::store(xs + i, P::mul(P::load(xs + i), P::set(fx)));
+            P::store(ys + i, P::mul(P::load(ys + i), P::set(fy)));
+        });
+    };
+
+    table.dot = [](const float* xs, const float* ys, const float* other_xs, const float* other_ys, float* out, size_t n) {
+        for_each_pack<Simd_pack>(n, [=](auto pack, size_t i) {
+            using P = decltype(pack);
+            P::store(out + i, P::add(P::mul(P::load(xs + i), P::load(other_xs + i)),
+                                     P::mul(P::load(ys + i), P::load(other_ys + i))));
+        });
+    };
+
+    table.len = [](const float* xs, const float* ys, float* out, size_t n) {
+        for_each_pack<Simd_pack>(n, [=](auto pack, size_t i) {
+            using P = decltype(pack);
+            typename P::reg x = P::load(xs + i);
+            typename P::reg y = P::load(ys + i);
+            P::store(out + i, P::sqrt(P::add(P::mul(x, x), P::mul(y, y))));
+        });
+    };
+
+    table.normalize = [](float* xs, float* ys, size_t n) {
+        for_each_pack<Simd_pack>(n, [=](auto pack, size_t i) {
+            using P = decltype(pack);
+            typename P::reg x = P::load(xs + i);
+            typename P::reg y = P::load(ys + i);
+            typename P::reg len = P::sqrt(P::add(P::mul(x, x), P::mul(y, y)));
+            // Zero-length vectors would produce NaN -- keep them zero
+            P::store(xs + i, P::keep_positive(P::div(x, len), len));
+            P::store(ys + i, P::keep_positive(P::div(y, len), len));
+        });
+    };
+
+    table.clamp = [](float* xs, float* ys, Vector2f upper_bound, Vector2f lower_bound, size_t n) {
+        for_each_pack<Simd_pack>(n, [=](auto pack, size_t i) {
+            using P = decltype(pack);
+            P::store(xs + i, P::max(P::set(lower_bound.x), P::min(P::load(xs + i), P::set(upper_bound.x - 1))));
+            P::store(ys + i, P::max(P::set(lower_bound.y), P::min(P::load(ys + i), P::set(upper_bound.y - 1))));
+        });
+    };
+
+    table.len_manh = [](const float* xs, const float* ys, float* out, size_t n) {
+        for_each_pack<Simd_pack>(n, [=](auto pack, size_t i) {
+            using P = decltype(pack);
+            P::store(out + i, P::add(P::abs(P::load(xs + i)), P::abs(P::load(ys + i))));
+        });
+    };
+
+    table.len_chess = [](const float* xs, const float* ys, float* out, size_t n) {
+        for_each_pack<Simd_pack>(n, [=](auto pack, size_t i) {
+            using P = decltype(pack);
+            P::store(out + i, P::max(P::abs(P::load(xs + i)), P::abs(P::load(ys + i))));
+        });
+    };
+
+    return table;
+}
+
+} // namespace